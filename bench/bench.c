@@ -0,0 +1,93 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bench.h"
+
+// A small harness shared by the benchmarks. Each benchmark times a few
+// samples, each doing the same amount of operations, and reports them
+// with `bench_report`. A whole suite prints as one JSON document:
+//
+//   {"suite": "hash", "results": [
+//     {"name": "get_hit", "params": {...}, "ops": 49152, "samples": 15,
+//      "ns_per_op": {"mean": ..., "min": ..., "p50": ..., "p90": ...,
+//                    "p99": ..., "max": ...}, "ops_per_sec": ...},
+//     ...]}
+//
+// Operations are far too short to time one by one, so the percentiles
+// are over the mean time per operation of each sample, not over single
+// operations. Throughput is taken from the median sample.
+
+volatile uintptr_t bench_sink;
+
+static unsigned int _bench_results;
+
+uint64_t bench_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+// Deterministic, so that every run benchmarks the same inputs
+// (xorshift64, by George Marsaglia).
+uint64_t bench_random(uint64_t* state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+void bench_begin(const char* suite) {
+  printf("{\"suite\": \"%s\", \"results\": [", suite);
+  _bench_results = 0;
+}
+
+static int _bench_compare(const void* left, const void* right) {
+  double l = *(const double*) left;
+  double r = *(const double*) right;
+  return (l > r) - (l < r);
+}
+
+// Nearest rank percentile of sorted values.
+static double _bench_percentile(const double* sorted, unsigned int count, unsigned int percent) {
+  unsigned int rank = (percent * count + 99) / 100;
+  return sorted[rank ? rank - 1 : 0];
+}
+
+// Reports a benchmark of `ops` operations per sample. `params` is the
+// body of a JSON object describing the inputs, such as `"load": 0.5`,
+// and may be NULL.
+void bench_report(const char* name, const char* params, size_t ops, const uint64_t* sample_ns, unsigned int samples) {
+  if (samples == 0 || ops == 0) return;
+  if (samples > BENCH_MAX_SAMPLES)
+    samples = BENCH_MAX_SAMPLES;
+
+  double per_op[BENCH_MAX_SAMPLES];
+  double total = 0.0;
+  for (unsigned int i = 0; i < samples; i++) {
+    per_op[i] = (double) sample_ns[i] / (double) ops;
+    total += per_op[i];
+  }
+  qsort(per_op, samples, sizeof(double), _bench_compare);
+  double p50 = _bench_percentile(per_op, samples, 50);
+
+  printf("%s\n  {\"name\": \"%s\", \"params\": {%s}, \"ops\": %zu, \"samples\": %u,",
+         _bench_results ? "," : "", name, params ? params : "", ops, samples);
+  printf(" \"ns_per_op\": {\"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},",
+         total / samples, per_op[0], p50, _bench_percentile(per_op, samples, 90),
+         _bench_percentile(per_op, samples, 99), per_op[samples - 1]);
+  printf(" \"ops_per_sec\": %.0f}", p50 > 0.0 ? 1e9 / p50 : 0.0);
+  fflush(stdout);
+  _bench_results += 1;
+}
+
+void bench_end(void) {
+  printf("\n]}\n");
+}
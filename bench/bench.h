@@ -0,0 +1,27 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_BENCH_H_
+#define SW2ALG_BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Most samples a single result can hold.
+#define BENCH_MAX_SAMPLES 256
+
+// Where benchmarks put what they compute, so the compiler can not drop
+// the work as unused.
+extern volatile uintptr_t bench_sink;
+
+uint64_t bench_now_ns(void);
+uint64_t bench_random(uint64_t* state);
+
+void bench_begin(const char* suite);
+void bench_report(const char* name, const char* params, size_t ops, const uint64_t* sample_ns, unsigned int samples);
+void bench_end(void);
+
+#endif //SW2ALG_BENCH_H_
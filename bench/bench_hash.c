@@ -0,0 +1,167 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "hash.h"
+
+// Times puts into an empty table, gets of stored and of missing keys,
+// removes, and the probe of `_hash_desired_index`, for fixed size tables
+// filled to several load factors, with keys of several lengths.
+//
+// Usage: bench_hash [slots], 65536 slots by default.
+
+#define BENCH_HASH_SAMPLES 15
+
+typedef struct BenchKeys {
+  const char* name;
+  unsigned int min_len;
+  unsigned int max_len;
+} bench_keys_t;
+
+static const bench_keys_t KEY_LENGTHS[] = {
+  { "short", 8, 8 },
+  { "long", 64, 64 },
+  { "mixed", 8, 64 },
+};
+
+typedef struct BenchTable {
+  const char* name;
+  unsigned int flags;
+} bench_table_t;
+
+static const bench_table_t TABLES[] = {
+  { "plain", 0 },
+  { "own_keys", HASH_OWN_KEYS },
+  { "swiss", HASH_SWISS | HASH_OWN_KEYS },
+  { "interleaved", HASH_INTERLEAVED | HASH_OWN_KEYS },
+  { "filter", HASH_FILTER | HASH_OWN_KEYS },
+};
+
+static const double LOADS[] = { 0.25, 0.5, 0.75, 0.9 };
+
+// Makes `count` distinct keys. Each key starts with its index in base
+// 32, so no two are the same, and is padded with random letters.
+static char** _bench_keys(unsigned int count, const bench_keys_t* lengths, uint64_t* rng) {
+  char** keys = malloc(count * sizeof(char*));
+  if (keys == NULL) return NULL;
+  for (unsigned int i = 0; i < count; i++) {
+    unsigned int len = lengths->min_len;
+    if (lengths->max_len > lengths->min_len)
+      len += (unsigned int) (bench_random(rng) % (lengths->max_len - lengths->min_len + 1));
+    char* key = malloc(len + 1);
+    if (key == NULL) exit(1);
+
+    unsigned int at = 0;
+    for (unsigned int n = i; at < len; n >>= 5) {
+      key[at++] = "0123456789abcdefghijklmnopqrstuv"[n & 31];
+      if (n < 32) break;
+    }
+    key[at++] = '-';
+    for (; at < len; at++)
+      key[at] = (char) ('a' + bench_random(rng) % 26);
+    key[len] = '\0';
+    keys[i] = key;
+  }
+  return keys;
+}
+
+static void _bench_keys_free(char** keys, unsigned int count) {
+  for (unsigned int i = 0; i < count; i++)
+    free(keys[i]);
+  free(keys);
+}
+
+static hash_t* _bench_fill(const bench_table_t* table, unsigned int slots, char** keys, unsigned int count) {
+  hash_t* hash_table = hash_new_flags(slots, table->flags);
+  if (hash_table == NULL) exit(1);
+  for (unsigned int i = 0; i < count; i++)
+    if (hash_put(hash_table, keys[i], keys[i]) == NULL) exit(1);
+  return hash_table;
+}
+
+static void _bench_table(const bench_table_t* table, unsigned int slots, const bench_keys_t* lengths, double load) {
+  uint64_t rng = 0x9E3779B97F4A7C15ull;
+  // Swiss tables round their size up, fill what was actually made.
+  hash_t* probe = hash_new_flags(slots, table->flags);
+  if (probe == NULL) exit(1);
+  unsigned int size = probe->size;
+  hash_free(probe);
+
+  unsigned int count = (unsigned int) (load * size);
+  char** keys = _bench_keys(count * 2, lengths, &rng);
+  if (keys == NULL) exit(1);
+  char** misses = keys + count;
+
+  char params[160];
+  snprintf(params, sizeof(params), "\"table\": \"%s\", \"slots\": %u, \"load\": %.2f, \"keys\": \"%s\"",
+           table->name, size, load, lengths->name);
+
+  // The first sample only warms up, and is left out of the report.
+  uint64_t samples[BENCH_HASH_SAMPLES + 1];
+  for (unsigned int s = 0; s <= BENCH_HASH_SAMPLES; s++) {
+    hash_t* hash_table = hash_new_flags(slots, table->flags);
+    if (hash_table == NULL) exit(1);
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+      bench_sink += (uintptr_t) hash_put(hash_table, keys[i], keys[i]);
+    samples[s] = bench_now_ns() - start;
+    hash_free(hash_table);
+  }
+  bench_report("put", params, count, samples + 1, BENCH_HASH_SAMPLES);
+
+  hash_t* hash_table = _bench_fill(table, slots, keys, count);
+  for (unsigned int s = 0; s <= BENCH_HASH_SAMPLES; s++) {
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+      bench_sink += (uintptr_t) hash_get(hash_table, keys[i]);
+    samples[s] = bench_now_ns() - start;
+  }
+  bench_report("get_hit", params, count, samples + 1, BENCH_HASH_SAMPLES);
+
+  for (unsigned int s = 0; s <= BENCH_HASH_SAMPLES; s++) {
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+      bench_sink += (uintptr_t) hash_get(hash_table, misses[i]);
+    samples[s] = bench_now_ns() - start;
+  }
+  bench_report("get_miss", params, count, samples + 1, BENCH_HASH_SAMPLES);
+
+  for (unsigned int s = 0; s <= BENCH_HASH_SAMPLES; s++) {
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+      bench_sink += (uintptr_t) _hash_desired_index(hash_table, keys[i]);
+    samples[s] = bench_now_ns() - start;
+  }
+  bench_report("desired_index", params, count, samples + 1, BENCH_HASH_SAMPLES);
+  hash_free(hash_table);
+
+  for (unsigned int s = 0; s <= BENCH_HASH_SAMPLES; s++) {
+    hash_table = _bench_fill(table, slots, keys, count);
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+      bench_sink += (uintptr_t) hash_remove(hash_table, keys[i]);
+    samples[s] = bench_now_ns() - start;
+    hash_free(hash_table);
+  }
+  bench_report("remove", params, count, samples + 1, BENCH_HASH_SAMPLES);
+
+  _bench_keys_free(keys, count * 2);
+}
+
+int main(int argc, char** argv) {
+  unsigned int slots = argc > 1 ? (unsigned int) strtoul(argv[1], NULL, 10) : 65536;
+  if (slots < 16) slots = 16;
+
+  bench_begin("hash");
+  for (size_t t = 0; t < sizeof(TABLES) / sizeof(TABLES[0]); t++)
+    for (size_t k = 0; k < sizeof(KEY_LENGTHS) / sizeof(KEY_LENGTHS[0]); k++)
+      for (size_t l = 0; l < sizeof(LOADS) / sizeof(LOADS[0]); l++)
+        _bench_table(&TABLES[t], slots, &KEY_LENGTHS[k], LOADS[l]);
+  bench_end();
+  return 0;
+}
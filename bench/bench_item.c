@@ -0,0 +1,119 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "item.h"
+
+// Times `item_equal` between pairs of items of each kind, both where
+// they are equal and where they differ, and `item_hash` of each kind.
+//
+// Usage: bench_item [pairs], 1000000 by default.
+
+#define BENCH_ITEM_SAMPLES 25
+
+static const char* WORDS[] = {
+  "Denmark", "Germany", "Sweden", "Norway", "Finland", "Iceland", "Estonia", "Latvia",
+  "Lithuania", "Poland", "the Netherlands", "Belgium", "Luxembourg", "Liechtenstein",
+  "Switzerland", "Bosnia and Herzegovina",
+};
+#define WORD_COUNT (sizeof(WORDS) / sizeof(WORDS[0]))
+
+// Makes an item of the given kind out of the n-th value.
+static item_t _bench_item(char type, unsigned int n) {
+  const char* word = WORDS[n % WORD_COUNT];
+  switch (type) {
+    case 'i':
+      return (item_t) { .type = 'i', .data.i = (int) n };
+    case 'd':
+      return (item_t) { .type = 'd', .data.d = n * 0.5 };
+    case 'S':
+      return (item_t) { .type = 'S', .data.S = (char*) word };
+    case 'q':
+      return item_string(word); // Long words still end up as `s`.
+    case 'h':
+      return item_str(word);
+  };
+  return ITEM_NULL;
+}
+
+static void _bench_items_free(item_t* items, unsigned int count) {
+  for (unsigned int i = 0; i < count; i++)
+    item_free(items[i]);
+  free(items);
+}
+
+// Compares items of kind `left_type` to items of kind `right_type`. With
+// `offset` 0 each pair is equal, otherwise each pair differs.
+static void _bench_equal(char left_type, char right_type, unsigned int offset, unsigned int count) {
+  item_t* left = malloc(count * sizeof(item_t));
+  item_t* right = malloc(count * sizeof(item_t));
+  if (left == NULL || right == NULL) exit(1);
+  uint64_t rng = 0x9E3779B97F4A7C15ull;
+  for (unsigned int i = 0; i < count; i++) {
+    unsigned int n = (unsigned int) bench_random(&rng);
+    left[i] = _bench_item(left_type, n);
+    right[i] = _bench_item(right_type, n + offset);
+  }
+
+  char params[96];
+  snprintf(params, sizeof(params), "\"left\": \"%c\", \"right\": \"%c\", \"equal\": %s",
+           left_type, right_type, offset ? "false" : "true");
+  // The first sample only warms up, and is left out of the report.
+  uint64_t samples[BENCH_ITEM_SAMPLES + 1];
+  for (unsigned int s = 0; s <= BENCH_ITEM_SAMPLES; s++) {
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+      bench_sink += (uintptr_t) item_equal(left[i], right[i]);
+    samples[s] = bench_now_ns() - start;
+  }
+  bench_report("equal", params, count, samples + 1, BENCH_ITEM_SAMPLES);
+
+  _bench_items_free(left, count);
+  _bench_items_free(right, count);
+}
+
+static void _bench_hash(char type, unsigned int count) {
+  item_t* items = malloc(count * sizeof(item_t));
+  if (items == NULL) exit(1);
+  uint64_t rng = 0x9E3779B97F4A7C15ull;
+  for (unsigned int i = 0; i < count; i++)
+    items[i] = _bench_item(type, (unsigned int) bench_random(&rng));
+
+  char params[32];
+  snprintf(params, sizeof(params), "\"type\": \"%c\"", type);
+  // The first sample only warms up, and is left out of the report.
+  uint64_t samples[BENCH_ITEM_SAMPLES + 1];
+  for (unsigned int s = 0; s <= BENCH_ITEM_SAMPLES; s++) {
+    uint64_t start = bench_now_ns();
+    for (unsigned int i = 0; i < count; i++)
+      bench_sink += (uintptr_t) item_hash(items[i]);
+    samples[s] = bench_now_ns() - start;
+  }
+  bench_report("hash", params, count, samples + 1, BENCH_ITEM_SAMPLES);
+
+  _bench_items_free(items, count);
+}
+
+int main(int argc, char** argv) {
+  unsigned int count = argc > 1 ? (unsigned int) strtoul(argv[1], NULL, 10) : 1000000;
+  if (count == 0) count = 1;
+
+  static const char TYPES[] = { 'i', 'd', 'S', 'q', 'h' };
+  bench_begin("item");
+  for (size_t t = 0; t < sizeof(TYPES); t++) {
+    _bench_equal(TYPES[t], TYPES[t], 0, count);
+    _bench_equal(TYPES[t], TYPES[t], 1, count);
+  }
+  // Strings of differing kinds, which can not take any shortcuts.
+  _bench_equal('S', 'h', 0, count);
+  _bench_equal('q', 'h', 0, count);
+  for (size_t t = 0; t < sizeof(TYPES); t++)
+    _bench_hash(TYPES[t], count);
+  bench_end();
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "item.h"
+#include "list.h"
+
+// Times appending to a list, scanning all of it with `list_find` and
+// `list_find_int`, and removing every element from the front, for lists
+// of 1e3 up to 1e7 elements, with nodes from Malloc and from a pool.
+//
+// Usage: bench_list [max elements], 10000000 by default.
+
+// Every size does about this many operations, in up to this many
+// samples, but at least the minimum.
+#define BENCH_LIST_WORK 20000000u
+#define BENCH_LIST_MAX_SAMPLES 25u
+#define BENCH_LIST_MIN_SAMPLES 5u
+
+static node_t* _bench_list_new(int pooled) {
+  node_t* list;
+  if (pooled) {
+    node_pool_t* pool = list_pool_new(0);
+    if (pool == NULL) exit(1);
+    list = list_new_pooled(pool);
+    list_pool_free(pool);
+  } else {
+    list = list_new();
+  }
+  if (list == NULL) exit(1);
+  return list;
+}
+
+static void _bench_list_fill(node_t* list, unsigned int count) {
+  for (unsigned int i = 0; i < count; i++)
+    if (list_append(list, (item_t) { .type = 'i', .data.i = (int) i }) == NULL) exit(1);
+}
+
+static void _bench_list(unsigned int count, int pooled) {
+  unsigned int samples_count = BENCH_LIST_WORK / count;
+  if (samples_count > BENCH_LIST_MAX_SAMPLES) samples_count = BENCH_LIST_MAX_SAMPLES;
+  if (samples_count < BENCH_LIST_MIN_SAMPLES) samples_count = BENCH_LIST_MIN_SAMPLES;
+
+  char params[96];
+  snprintf(params, sizeof(params), "\"nodes\": \"%s\", \"length\": %u", pooled ? "pool" : "malloc", count);
+
+  // The first sample only warms up, and is left out of the report.
+  uint64_t samples[BENCH_LIST_MAX_SAMPLES + 1];
+  for (unsigned int s = 0; s <= samples_count; s++) {
+    node_t* list = _bench_list_new(pooled);
+    uint64_t start = bench_now_ns();
+    _bench_list_fill(list, count);
+    samples[s] = bench_now_ns() - start;
+    list_free(list);
+  }
+  bench_report("append", params, count, samples + 1, samples_count);
+
+  node_t* list = _bench_list_new(pooled);
+  _bench_list_fill(list, count);
+  // Look for an item which is not there, so every element is compared.
+  item_t missing = { .type = 'i', .data.i = -1 };
+  for (unsigned int s = 0; s <= samples_count; s++) {
+    uint64_t start = bench_now_ns();
+    bench_sink += (uintptr_t) list_find(list, missing);
+    samples[s] = bench_now_ns() - start;
+  }
+  bench_report("scan_find", params, count, samples + 1, samples_count);
+
+  for (unsigned int s = 0; s <= samples_count; s++) {
+    uint64_t start = bench_now_ns();
+    bench_sink += (uintptr_t) list_find_int(list, -1);
+    samples[s] = bench_now_ns() - start;
+  }
+  bench_report("scan_find_int", params, count, samples + 1, samples_count);
+  list_free(list);
+
+  for (unsigned int s = 0; s <= samples_count; s++) {
+    list = _bench_list_new(pooled);
+    _bench_list_fill(list, count);
+    uint64_t start = bench_now_ns();
+    while (list->next != list)
+      bench_sink += (uintptr_t) list_elem_remove(list, list->next).data.i;
+    samples[s] = bench_now_ns() - start;
+    list_free(list);
+  }
+  bench_report("remove_front", params, count, samples + 1, samples_count);
+}
+
+int main(int argc, char** argv) {
+  unsigned long max = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000ul;
+
+  bench_begin("list");
+  for (unsigned long count = 1000; count <= max; count *= 10) {
+    _bench_list((unsigned int) count, 0);
+    _bench_list((unsigned int) count, 1);
+  }
+  bench_end();
+  return 0;
+}
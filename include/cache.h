@@ -0,0 +1,57 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_CACHE_H_
+#define SW2ALG_CACHE_H_
+
+#include <stddef.h>
+#include "lhash.h"
+
+// Eviction policies for `cache_new`.
+#define CACHE_LRU 0u // Evict the least recently used key.
+#define CACHE_CLOCK 1u // Evict the oldest key not used since last checked.
+
+// Called with every value the cache lets go of by itself, on eviction,
+// replacement or `cache_free`. The key is only valid during the call.
+typedef void (*cache_free_t)(const char* key, void* value);
+
+typedef struct CacheEntry {
+  void* value;
+  size_t bytes;
+  int referenced; // CACHE_CLOCK: used since the clock hand last passed.
+} cache_entry_t;
+
+typedef struct Cache {
+  lhash_t* map; // Maps keys to `cache_entry_t`.
+  unsigned int policy;
+  size_t max_entries; // 0 for no limit.
+  size_t max_bytes; // 0 for no limit.
+  size_t bytes;
+  cache_free_t free_value;
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+} cache_t;
+
+typedef struct CacheStats {
+  size_t count;
+  size_t bytes;
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+  double hit_rate;
+} cache_stats_t;
+
+cache_t* cache_new(size_t max_entries, size_t max_bytes, unsigned int policy, cache_free_t free_value);
+void cache_free(cache_t* cache);
+
+void* cache_get(cache_t* cache, const char* key);
+int cache_put(cache_t* cache, const char* key, void* value, size_t bytes);
+void* cache_remove(cache_t* cache, const char* key);
+
+void cache_stats(const cache_t* cache, cache_stats_t* stats);
+
+#endif //SW2ALG_CACHE_H_
@@ -0,0 +1,73 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_CHASH_H_
+#define SW2ALG_CHASH_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include "hash.h"
+
+// Amount of locks writers are spread over, by the hash of their key. A
+// resize takes all of them, holding up every writer until it is done,
+// while readers carry on.
+#define CHASH_STRIPES 64
+// Threads which can read with a slot of their own, see `chash.c`.
+#define CHASH_READERS 64
+// Assumed size of a cache line, to keep apart what different readers write.
+#define CHASH_CACHE_LINE 64
+#define CHASH_MAX_LOAD 0.5
+// Reuses the reserved tombstone hash, which removals do not need here.
+#define CHASH_BUSY HASH_TOMBSTONE
+
+typedef struct ConcurrentHashSlot {
+  // HASH_EMPTY, CHASH_BUSY while being claimed, or the key's hash. Once
+  // set, the key of a slot never changes until the table is replaced.
+  _Atomic unsigned long hash;
+  _Atomic(void*) value; // NULL once the key is removed.
+  char* key;
+  size_t len;
+} chash_slot_t;
+
+typedef struct ConcurrentHashTable {
+  unsigned int size; // Always a power of two.
+  chash_slot_t* slots;
+  _Atomic unsigned int used; // Claimed slots, including removed keys.
+} chash_table_t;
+
+// Odd while the thread owning the slot is reading, and only ever
+// written by that thread.
+typedef struct ConcurrentHashReader {
+  _Atomic unsigned long seq;
+  char pad[CHASH_CACHE_LINE - sizeof(unsigned long)];
+} chash_reader_t;
+
+typedef struct ConcurrentHash {
+  _Atomic(chash_table_t*) table;
+  // Readers mark themselves in a slot of their own, so a resize knows
+  // when nobody can be reading the table it replaced.
+  chash_reader_t* readers; // CHASH_READERS slots, each on its own cache line.
+  // Threads beyond CHASH_READERS register in the counter of the current
+  // epoch instead.
+  _Atomic unsigned long epoch;
+  _Atomic unsigned long overflow[2];
+  _Atomic unsigned int count;
+  pthread_mutex_t stripes[CHASH_STRIPES];
+  hash_func_t hash_func;
+  unsigned long seed;
+} chash_t;
+
+chash_t* chash_new(unsigned int size);
+void chash_free(chash_t* hash_table);
+
+void* chash_get(chash_t* hash_table, const char* key);
+void* chash_put(chash_t* hash_table, const char* key, void* value);
+void* chash_remove(chash_t* hash_table, const char* key);
+
+int chash_count(chash_t* hash_table);
+
+#endif //SW2ALG_CHASH_H_
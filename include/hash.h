@@ -7,15 +7,116 @@
 #ifndef SW2ALG_HASH_H_
 #define SW2ALG_HASH_H_
 
+#include <stddef.h>
+#include "wyhash.h"
+
+// Reserved values of `keys[]`. Hashes which would collide with these
+// are remapped before they are stored.
+#define HASH_EMPTY 0ul
+#define HASH_TOMBSTONE 1ul
+
+// Flags for `hash_new_flags`.
+#define HASH_GROWABLE 0x1u // Grow instead of failing when full.
+#define HASH_OWN_KEYS 0x2u // Keep a copy of every key, not just its hash.
+#define HASH_SWISS 0x4u // Probe with control bytes, a group at a time.
+#define HASH_SEEDED 0x8u // Hash with `hash_wy` and a random seed.
+#define HASH_INTERLEAVED 0x10u // Keep each slot's hash and value together.
+#define HASH_FILTER 0x20u // Rule out most misses with a Bloom filter before probing.
+
+#define HASH_DEFAULT_MAX_LOAD 0.75
+// Least amount of slots migrated from an old table on each put or remove.
+#define HASH_REHASH_STEP 16
+// Amount of keys hashed and prefetched together by the `_many` calls.
+#define HASH_BATCH 16
+// Amount of control bytes matched at once by HASH_SWISS tables.
+#define HASH_SWISS_GROUP 16
+// Bits of Bloom filter per slot of HASH_FILTER tables.
+#define HASH_FILTER_BITS 16
+// Most threads `hash_build` uses, and the least slots each thread gets.
+#define HASH_BUILD_MAX_THREADS 64
+#define HASH_BUILD_MIN_SLOTS 4096
+// Version of the snapshot format written by `hash_save`.
+#define HASH_SNAPSHOT_VERSION 1
+
+// Hashes `len` bytes of `key`. The seed should change the hashes of all
+// keys, so that colliding keys cannot be picked ahead of time.
+typedef unsigned long (*hash_func_t)(const char* key, size_t len, unsigned long seed);
+
 typedef struct Hash {
   unsigned int size;
   unsigned long* keys;
   void** values;
+  // Bytes from one slot to the next in `keys`, `values` and `key_refs`.
+  // With HASH_INTERLEAVED all three point into a single array of slots,
+  // so a lookup finds the value on the cache line its hash was read
+  // from, and the arrays can no longer be indexed directly.
+  unsigned int key_stride;
+  unsigned int value_stride;
+  unsigned int ref_stride;
+  unsigned int flags;
+  unsigned int count; // Amount of live keys in `keys`.
+  unsigned int tombstones; // Amount of HASH_TOMBSTONE slots in `keys`.
+  // Probe statistics, see `hash_stats`.
+  unsigned int displaced;
+  unsigned int max_probe;
+  unsigned long probe_total;
+  double max_load;
+  hash_func_t hash_func;
+  unsigned long seed;
+  // When a growable table resizes, its old arrays are kept here and
+  // moved over a few slots at a time by puts and removes, instead of all
+  // at once. Gets never move anything.
+  struct Hash* draining;
+  unsigned int drain_pos;
+  // With HASH_OWN_KEYS each key is copied into `arena` behind its
+  // length, and `key_refs` holds the offset of each slot's key.
+  size_t* key_refs;
+  char* arena;
+  size_t arena_len;
+  size_t arena_cap;
+  size_t arena_garbage; // Bytes in `arena` of keys no longer stored.
+  // With HASH_SWISS, one control byte per slot holding 7 bits of the
+  // slot's hash, or marking it as empty or deleted.
+  signed char* ctrl;
+  // With HASH_FILTER, a Bloom filter of the keys in blocks of a cache
+  // line, which is checked before probing for a key.
+  unsigned long long* filter;
+  unsigned int filter_mask; // Amount of blocks, less one.
+  unsigned int filter_stale; // Keys removed since it was last rebuilt.
+  // Set for a table loaded by `hash_load`, whose arrays all point into
+  // this read-only mapping of the snapshot. Such a table can not change.
+  void* mapping;
+  size_t mapping_len;
+  // Start of the encoded values in `mapping`, which the values of the
+  // slots are offsets into. NULL if the values were saved as they were.
+  const char* mapped_values;
 } hash_t;
 
+typedef struct HashStats {
+  unsigned int size;
+  unsigned int count;
+  unsigned int tombstones;
+  unsigned int displaced; // Keys not in the slot (or group) they hash to.
+  // Longest probe of any key since the table was last resized. Probes
+  // are counted in slots, or in groups for HASH_SWISS tables.
+  unsigned int max_probe;
+  double load_factor;
+  double mean_probe; // Mean probe length of looking up a stored key.
+} hash_stats_t;
+
+// Returns `len` bytes encoding a value, which `hash_save` writes out in
+// its place. A table loaded from the snapshot returns a pointer to these
+// bytes as the value. Returning NULL fails the save.
+typedef const void* (*hash_encode_t)(const void* value, size_t* len, void* ctx);
+
 unsigned long djb2_hash(const char* str);
+unsigned long hash_djb2(const char* key, size_t len, unsigned long seed);
+unsigned long hash_random_seed(void);
 
 hash_t* hash_new(unsigned int size);
+hash_t* hash_new_flags(unsigned int size, unsigned int flags);
+void hash_set_max_load(hash_t* hash_table, double max_load);
+int hash_set_func(hash_t* hash_table, hash_func_t hash_func, unsigned long seed);
 void hash_free(hash_t* hash_table);
 
 int _hash_desired_index(const hash_t* hash_table, const char* key);
@@ -25,6 +126,16 @@ void* hash_get(const hash_t* hash_table, const char* key);
 void* hash_put(hash_t* hash_table, const char* key, void* value);
 void* hash_remove(hash_t* hash_table, const char* key);
 
-int hash_count(hash_t* hash_table);
+void hash_get_many(const hash_t* hash_table, const char* const* keys, size_t n, void** values);
+size_t hash_put_many(hash_t* hash_table, const char* const* keys, void* const* values, size_t n);
+
+int hash_count(const hash_t* hash_table);
+void hash_stats(const hash_t* hash_table, hash_stats_t* stats);
+
+hash_t* hash_build(const char* const* keys, void* const* values, size_t n, unsigned int flags,
+                   unsigned int threads);
+
+int hash_save(hash_t* hash_table, const char* path, hash_encode_t encode, void* ctx);
+hash_t* hash_load(const char* path);
 
 #endif //SW2ALG_HASH_H_
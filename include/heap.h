@@ -0,0 +1,52 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_HEAP_H_
+#define SW2ALG_HEAP_H_
+
+#include "item.h"
+
+// Children of each item in the heap.
+#define HEAP_ARITY 4
+// Capacity of a heap once it first needs room for items.
+#define HEAP_MIN_CAPACITY 8
+// Returned instead of a handle if Malloc fails.
+#define HEAP_NO_HANDLE ((heap_handle_t) -1)
+
+// Finds an item in the heap: its slot in the low 32 bits, and the
+// generation of that slot in the high 32 bits.
+typedef unsigned long long heap_handle_t;
+
+typedef struct Heap {
+  item_cmp_t cmp;
+  item_t* items; // In heap order, smallest first.
+  unsigned int* slots; // The slot of each item in `items`.
+  // The position in `items` of each slot, or the next free slot with
+  // _HEAP_FREE set if it is not in use.
+  unsigned int* positions;
+  unsigned int* generations; // Times each slot was given back.
+  unsigned int length;
+  unsigned int capacity;
+  unsigned int slots_used; // Slots given out so far, live or free.
+  unsigned int free_slot; // First free slot.
+} heap_t;
+
+heap_t* heap_new(unsigned int capacity, item_cmp_t cmp);
+heap_t* heap_from_array(const item_t* items, unsigned int count, item_cmp_t cmp);
+void heap_free(heap_t* heap);
+
+int heap_empty(const heap_t* heap);
+int heap_length(const heap_t* heap);
+
+heap_handle_t heap_push(heap_t* heap, item_t item);
+item_t* heap_peek(const heap_t* heap);
+item_t heap_pop(heap_t* heap);
+
+item_t* heap_get(const heap_t* heap, heap_handle_t handle);
+int heap_update(heap_t* heap, heap_handle_t handle, item_t item);
+item_t heap_remove(heap_t* heap, heap_handle_t handle);
+
+#endif //SW2ALG_HEAP_H_
@@ -0,0 +1,51 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_ILIST_H_
+#define SW2ALG_ILIST_H_
+
+#include "item.h"
+
+// Most levels a node can have. With a quarter of nodes making it to each
+// next level, this is plenty for 2^32 items.
+#define ILIST_MAX_LEVEL 16
+
+typedef struct IndexedLink {
+  struct IndexedNode* next; // NULL past the last node.
+  // Positions skipped by following `next`, where NULL counts as the
+  // position right after the last node.
+  unsigned int width;
+} ilink_t;
+
+typedef struct IndexedNode {
+  item_t item;
+  unsigned int level;
+  ilink_t links[]; // One per level, `links[0]` being the plain list.
+} inode_t;
+
+typedef struct IndexedList {
+  inode_t* head; // Holds no item, and has all ILIST_MAX_LEVEL links.
+  unsigned int length;
+  unsigned int level; // Highest level of any node.
+  unsigned long long rng; // State of the random generator picking levels.
+} ilist_t;
+
+ilist_t* ilist_new(void);
+void ilist_free(ilist_t* list);
+
+int ilist_empty(const ilist_t* list);
+int ilist_length(const ilist_t* list);
+
+item_t* ilist_insert(ilist_t* list, int pos, item_t item);
+item_t* ilist_prepend(ilist_t* list, item_t item);
+item_t* ilist_append(ilist_t* list, item_t item);
+
+item_t ilist_remove(ilist_t* list, int pos);
+
+item_t* ilist_at(const ilist_t* list, int pos);
+int ilist_find(const ilist_t* list, item_t item);
+
+#endif //SW2ALG_ILIST_H_
@@ -7,21 +7,53 @@
 #ifndef SW2ALG_ITEM_H_
 #define SW2ALG_ITEM_H_
 
+#include <stddef.h>
+
 #define ITEM_NULL (item_t) { .type = 'p', .data.p = NULL }
 
+// A string which knows its length and hash, so comparing two of them
+// rarely has to look at their bytes. Allocated in one piece.
+typedef struct ItemStr {
+  size_t len;
+  unsigned long hash; // As returned by `item_hash`.
+  char str[];
+} item_str_t;
+
+// Longest string an item can hold in itself, see `item_string`.
+#define ITEM_INLINE_MAX 14
+
 typedef struct Item {
-  char type;
   union {
-    int i;
-    double d;
-    char c;
-    char* s; // Dynamically allocated string.
-    char* S; // Statically allocated string.
-    void* p;
-  } data;
+    struct {
+      char type;
+      union {
+        int i;
+        double d;
+        char c;
+        char* s; // Dynamically allocated string.
+        char* S; // Statically allocated string.
+        void* p;
+        item_str_t* h; // Dynamically allocated string, from `item_str`.
+      } data;
+    };
+    // A `q` item holds a short string in itself, starting right after
+    // `type` (at `q + 1`), and zero padded up to the end of the item.
+    char q[ITEM_INLINE_MAX + 2];
+  };
 } item_t;
 
+item_t item_str(const char* str);
+item_t item_string(const char* str);
+const char* item_cstr(const item_t* item);
+
+// Orders two items, returning less than, equal to or greater than zero.
+typedef int (*item_cmp_t)(item_t left, item_t right);
+
 int item_equal(item_t left, item_t right);
+int item_compare(item_t left, item_t right);
+unsigned long item_hash(item_t item);
 void item_free(item_t item);
 
+void item_sort(item_t* items, size_t count, item_cmp_t cmp);
+
 #endif //SW2ALG_ITEM_H_
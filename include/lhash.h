@@ -0,0 +1,44 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_LHASH_H_
+#define SW2ALG_LHASH_H_
+
+#include "hash.h"
+#include "list.h"
+
+// Flags for `lhash_new_flags`.
+#define LHASH_ACCESS_ORDER 0x1u // Move keys to the front on every get.
+
+// What the items of `order` point to.
+typedef struct LinkedHashEntry {
+  void* value;
+  char key[];
+} lhash_entry_t;
+
+typedef struct LinkedHash {
+  hash_t* index; // Maps each key to its node in `order`.
+  // Newest (or most recently used) key first, the oldest last. Items
+  // are `p` items pointing to an `lhash_entry_t`.
+  node_t* order;
+  unsigned int flags;
+} lhash_t;
+
+lhash_t* lhash_new(unsigned int size);
+lhash_t* lhash_new_flags(unsigned int size, unsigned int flags);
+void lhash_free(lhash_t* map);
+
+void* lhash_get(lhash_t* map, const char* key);
+void* lhash_put(lhash_t* map, const char* key, void* value);
+void* lhash_remove(lhash_t* map, const char* key);
+
+int lhash_move_to_front(lhash_t* map, const char* key);
+const char* lhash_oldest(lhash_t* map);
+void* lhash_evict(lhash_t* map);
+
+int lhash_count(const lhash_t* map);
+
+#endif //SW2ALG_LHASH_H_
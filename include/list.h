@@ -9,27 +9,62 @@
 
 #include "item.h"
 
+// Default amount of nodes in the first slab of a node pool.
+#define LIST_POOL_SLAB 64
+
 typedef struct Node {
   item_t item;
   struct Node* prev;
   struct Node* next;
 } node_t;
 
+typedef struct NodeSlab {
+  struct NodeSlab* next;
+  node_t nodes[];
+} node_slab_t;
+
+// Hands out nodes from large slabs instead of allocating each on its
+// own. May be shared by several lists, and is freed with the last of
+// them (or `list_pool_free`, whichever comes last).
+typedef struct NodePool {
+  node_slab_t* slabs;
+  node_t* bump; // Next never used node of the newest slab.
+  node_t* bump_end;
+  node_t* free; // Recycled nodes, linked through `next`.
+  unsigned int slab_nodes; // Size of the next slab, doubling each time.
+  unsigned int refs;
+} node_pool_t;
+
 node_t* list_new(void);
+node_t* list_new_pooled(node_pool_t* pool);
 
 void list_free(node_t* const sentinel);
 
+node_pool_t* list_pool_new(unsigned int slab_nodes);
+void list_pool_free(node_pool_t* pool);
+
 int list_elem_is_sentinel(node_t* elem);
 int list_empty(node_t* const sentinel);
 
-node_t* list_elem_insert(node_t* left_elem, item_t item);
+node_t* list_elem_insert(node_t* const sentinel, node_t* left_elem, item_t item);
 node_t* list_prepend(node_t* const sentinel, item_t item);
 node_t* list_append(node_t* const sentinel, item_t item);
 
-item_t list_elem_remove(node_t* elem);
+item_t list_elem_remove(node_t* const sentinel, node_t* elem);
+void list_elem_move(node_t* elem, node_t* left_elem);
+
+int list_splice(node_t* const sentinel, node_t* left_elem, node_t* const other, node_t* first, node_t* last);
+int list_concat(node_t* const sentinel, node_t* const other);
+node_t* list_split_at(node_t* const sentinel, int pos);
+int list_append_array(node_t* const sentinel, const item_t* items, int count);
+
+void list_sort(node_t* const sentinel, item_cmp_t cmp);
+int list_sort_array(node_t* const sentinel, item_cmp_t cmp);
 
 node_t* list_at(node_t* const sentinel, int pos);
 node_t* list_find(node_t* const sentinel, item_t item);
+node_t* list_find_int(node_t* const sentinel, int value);
+node_t* list_find_str(node_t* const sentinel, const char* str);
 int list_length(node_t* const sentinel);
 
 #endif //SW2ALG_LIST_H_
@@ -0,0 +1,41 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_MPMC_H_
+#define SW2ALG_MPMC_H_
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "item.h"
+
+// Assumed size of a cache line, to keep apart what different threads write.
+#define MPMC_CACHE_LINE 64
+
+typedef struct MpmcCell {
+  // Tells whose turn it is at the cell, see `mpmc.c`.
+  _Atomic size_t sequence;
+  item_t item;
+} mpmc_cell_t;
+
+typedef struct Mpmc {
+  mpmc_cell_t* cells;
+  size_t mask; // Amount of cells minus one, always a power of two.
+  char pad0[MPMC_CACHE_LINE];
+  _Atomic size_t enqueue_pos;
+  char pad1[MPMC_CACHE_LINE - sizeof(size_t)];
+  _Atomic size_t dequeue_pos;
+  char pad2[MPMC_CACHE_LINE - sizeof(size_t)];
+} mpmc_t;
+
+mpmc_t* mpmc_new(unsigned int size);
+void mpmc_free(mpmc_t* queue);
+
+int mpmc_append(mpmc_t* queue, item_t item);
+item_t mpmc_remove(mpmc_t* queue);
+
+int mpmc_length(mpmc_t* queue);
+
+#endif //SW2ALG_MPMC_H_
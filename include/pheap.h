@@ -0,0 +1,40 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_PHEAP_H_
+#define SW2ALG_PHEAP_H_
+
+#include "item.h"
+
+typedef struct PairingNode {
+  item_t item;
+  struct PairingNode* child; // The first of its children.
+  struct PairingNode* next; // Its next sibling.
+  // Its previous sibling, or its parent if it is the first child.
+  struct PairingNode* prev;
+} pnode_t;
+
+typedef struct PairingHeap {
+  item_cmp_t cmp;
+  pnode_t* root; // The smallest item, NULL when empty.
+  unsigned int length;
+} pheap_t;
+
+pheap_t* pheap_new(item_cmp_t cmp);
+void pheap_free(pheap_t* heap);
+
+int pheap_empty(const pheap_t* heap);
+int pheap_length(const pheap_t* heap);
+
+pnode_t* pheap_push(pheap_t* heap, item_t item);
+item_t* pheap_peek(const pheap_t* heap);
+item_t pheap_pop(pheap_t* heap);
+
+int pheap_decrease(pheap_t* heap, pnode_t* node, item_t item);
+item_t pheap_remove(pheap_t* heap, pnode_t* node);
+void pheap_meld(pheap_t* heap, pheap_t* other);
+
+#endif //SW2ALG_PHEAP_H_
@@ -0,0 +1,40 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_ULIST_H_
+#define SW2ALG_ULIST_H_
+
+#include "item.h"
+
+// Amount of items per node, chosen so a node fits in 256 bytes.
+#define ULIST_NODE_ITEMS 14
+
+typedef struct UnrolledNode {
+  struct UnrolledNode* prev;
+  struct UnrolledNode* next;
+  // Amount of items in `items`. The sentinel holds no items, and instead
+  // counts the items of the whole list.
+  unsigned int count;
+  item_t items[ULIST_NODE_ITEMS];
+} unode_t;
+
+unode_t* ulist_new(void);
+
+void ulist_free(unode_t* const sentinel);
+
+int ulist_empty(unode_t* const sentinel);
+int ulist_length(unode_t* const sentinel);
+
+int ulist_insert(unode_t* const sentinel, int pos, item_t item);
+int ulist_prepend(unode_t* const sentinel, item_t item);
+int ulist_append(unode_t* const sentinel, item_t item);
+
+item_t ulist_remove(unode_t* const sentinel, int pos);
+
+item_t* ulist_at(unode_t* const sentinel, int pos);
+int ulist_find(unode_t* const sentinel, item_t item);
+
+#endif //SW2ALG_ULIST_H_
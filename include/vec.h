@@ -0,0 +1,40 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_VEC_H_
+#define SW2ALG_VEC_H_
+
+#include "item.h"
+
+// Capacity of a vector once it first needs room for items.
+#define VEC_MIN_CAPACITY 8
+
+typedef struct Vector {
+  item_t* items; // NULL until the vector first has a capacity.
+  unsigned int length;
+  unsigned int capacity;
+} vec_t;
+
+vec_t* vec_new(unsigned int capacity);
+void vec_free(vec_t* vec);
+
+int vec_empty(const vec_t* vec);
+int vec_length(const vec_t* vec);
+
+int vec_reserve(vec_t* vec, unsigned int capacity);
+int vec_shrink(vec_t* vec);
+
+int vec_insert(vec_t* vec, int pos, item_t item);
+int vec_append(vec_t* vec, item_t item);
+
+item_t vec_remove(vec_t* vec, int pos);
+item_t vec_pop(vec_t* vec);
+
+item_t* vec_at(const vec_t* vec, int pos);
+int vec_find(const vec_t* vec, item_t item);
+void vec_sort(vec_t* vec, item_cmp_t cmp);
+
+#endif //SW2ALG_VEC_H_
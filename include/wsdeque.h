@@ -0,0 +1,43 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_WSDEQUE_H_
+#define SW2ALG_WSDEQUE_H_
+
+#include <stdatomic.h>
+#include "item.h"
+#include "mpmc.h"
+
+// An item, stored as two words which can be read while being written.
+typedef struct WsdequeSlot {
+  _Atomic unsigned long long words[2];
+} wsdeque_slot_t;
+
+typedef struct WsdequeArray {
+  long size; // Always a power of two.
+  struct WsdequeArray* retired; // The smaller array this one replaced.
+  wsdeque_slot_t slots[];
+} wsdeque_array_t;
+
+typedef struct Wsdeque {
+  _Atomic(wsdeque_array_t*) array;
+  char pad0[MPMC_CACHE_LINE];
+  _Atomic long top; // Next item to steal.
+  char pad1[MPMC_CACHE_LINE - sizeof(long)];
+  _Atomic long bottom; // Next slot the owner appends to.
+  char pad2[MPMC_CACHE_LINE - sizeof(long)];
+} wsdeque_t;
+
+wsdeque_t* wsdeque_new(unsigned int size);
+void wsdeque_free(wsdeque_t* deque);
+
+int wsdeque_append(wsdeque_t* deque, item_t item);
+item_t wsdeque_remove(wsdeque_t* deque);
+item_t wsdeque_steal(wsdeque_t* deque);
+
+int wsdeque_length(wsdeque_t* deque);
+
+#endif //SW2ALG_WSDEQUE_H_
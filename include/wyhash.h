@@ -0,0 +1,17 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_WYHASH_H_
+#define SW2ALG_WYHASH_H_
+
+// The string hash shared by `hash_t` and `item_hash`, in a library of
+// its own so items do not depend on the hash table.
+
+#include <stddef.h>
+
+unsigned long hash_wy(const char* key, size_t len, unsigned long seed);
+
+#endif //SW2ALG_WYHASH_H_
@@ -0,0 +1,166 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include "cache.h"
+#include "lhash.h"
+
+// A cache bounded by a number of keys, a number of bytes, or both. Where
+// a full `hash_t` refuses new keys, a full cache makes room by evicting
+// keys, and hands their values to `free_value`.
+//
+// With CACHE_LRU the keys are kept in an access ordered `lhash_t`, so the
+// least recently used key is always last. CACHE_CLOCK keeps them in
+// insertion order instead, and a hit only sets a bit. On eviction the
+// last key is given a second chance (moved to the front, with its bit
+// cleared) if its bit was set. Hits thus never touch the list, which
+// matters when most gets are hits.
+//
+// Sizes in bytes are as given by the caller for each value.
+
+cache_t* cache_new(size_t max_entries, size_t max_bytes, unsigned int policy, cache_free_t free_value) {
+  cache_t* cache = calloc(1, sizeof(cache_t));
+  if (cache == NULL) return NULL;
+
+  unsigned int flags = policy == CACHE_LRU ? LHASH_ACCESS_ORDER : 0;
+  // A count limit tells us how large the table needs to get.
+  unsigned int size = max_entries && max_entries < 1u << 30 ? (unsigned int) max_entries * 2 : 0;
+  cache->map = lhash_new_flags(size, flags);
+  if (cache->map == NULL) {
+    free(cache);
+    return NULL;
+  }
+
+  cache->policy = policy;
+  cache->max_entries = max_entries;
+  cache->max_bytes = max_bytes;
+  cache->free_value = free_value;
+  return cache;
+}
+
+static cache_entry_t* _cache_entry(node_t* node) {
+  return ((lhash_entry_t*) node->item.data.p)->value;
+}
+
+static const char* _cache_key(node_t* node) {
+  return ((lhash_entry_t*) node->item.data.p)->key;
+}
+
+static void _cache_release(cache_t* cache, const char* key, cache_entry_t* entry) {
+  cache->bytes -= entry->bytes;
+  if (cache->free_value)
+    cache->free_value(key, entry->value);
+  free(entry);
+}
+
+// Frees every value still in the cache through `free_value`.
+void cache_free(cache_t* cache) {
+  node_t* order = cache->map->order;
+  for (node_t* node = order->next; node != order; node = node->next)
+    _cache_release(cache, _cache_key(node), _cache_entry(node));
+  lhash_free(cache->map);
+  free(cache);
+}
+
+// Return the value of a key, or NULL on a miss.
+void* cache_get(cache_t* cache, const char* key) {
+  cache_entry_t* entry = lhash_get(cache->map, key);
+  if (entry == NULL) {
+    cache->misses += 1;
+    return NULL;
+  }
+  cache->hits += 1;
+  entry->referenced = 1;
+  return entry->value;
+}
+
+// Picks the key to evict, giving recently used keys a second chance
+// under CACHE_CLOCK. Every pass clears a bit, so this always ends. The
+// key of `keep` is never picked, but there has to be another one.
+static node_t* _cache_victim(cache_t* cache, node_t* keep) {
+  node_t* order = cache->map->order;
+  node_t* node = order->prev;
+  while (node == keep || (cache->policy == CACHE_CLOCK && _cache_entry(node)->referenced)) {
+    if (node != keep)
+      _cache_entry(node)->referenced = 0;
+    list_elem_move(node, order);
+    node = order->prev;
+  }
+  return node;
+}
+
+static void _cache_evict(cache_t* cache, node_t* keep) {
+  node_t* node = _cache_victim(cache, keep);
+  cache->evictions += 1;
+  // Release before evicting, while the key is still around to pass on.
+  _cache_release(cache, _cache_key(node), _cache_entry(node));
+  // The victim is always the oldest key by now.
+  (void) lhash_evict(cache->map);
+}
+
+// Stores a value, taking `bytes` of the budget, and evicting as many keys
+// as it takes to stay within it. A value already stored under the key is
+// replaced, and given to `free_value` unless it is the same value.
+// Returns -1 if the value could never fit, or if Malloc fails, in which
+// case a value already stored under the key stays as it was.
+int cache_put(cache_t* cache, const char* key, void* value, size_t bytes) {
+  if (cache->max_bytes && bytes > cache->max_bytes) return -1;
+
+  cache_entry_t* entry = malloc(sizeof(cache_entry_t));
+  if (entry == NULL) return -1;
+  entry->value = value;
+  entry->bytes = bytes;
+  entry->referenced = 0;
+
+  // A replaced key keeps its node, and only has its entry swapped, which
+  // can not fail. It becomes the newest key, as a new key would.
+  node_t* node = hash_get(cache->map->index, key);
+  if (node) {
+    cache_entry_t* old = _cache_entry(node);
+    ((lhash_entry_t*) node->item.data.p)->value = entry;
+    list_elem_move(node, cache->map->order);
+    cache->bytes -= old->bytes;
+    if (cache->free_value && old->value != value)
+      cache->free_value(key, old->value);
+    free(old);
+  }
+
+  // Counting the keys other than this one, which are all that may go.
+  size_t others = (size_t) lhash_count(cache->map) - (node != NULL);
+  while (others > 0
+         && ((cache->max_entries && others + 1 > cache->max_entries)
+             || (cache->max_bytes && cache->bytes + bytes > cache->max_bytes))) {
+    _cache_evict(cache, node);
+    others -= 1;
+  }
+
+  if (node == NULL && lhash_put(cache->map, key, entry) == NULL) {
+    free(entry);
+    return -1;
+  }
+  cache->bytes += bytes;
+  return 0;
+}
+
+// Remove and return the value of a key, without calling `free_value`.
+void* cache_remove(cache_t* cache, const char* key) {
+  cache_entry_t* entry = lhash_remove(cache->map, key);
+  if (entry == NULL) return NULL;
+  void* value = entry->value;
+  cache->bytes -= entry->bytes;
+  free(entry);
+  return value;
+}
+
+void cache_stats(const cache_t* cache, cache_stats_t* stats) {
+  stats->count = lhash_count(cache->map);
+  stats->bytes = cache->bytes;
+  stats->hits = cache->hits;
+  stats->misses = cache->misses;
+  stats->evictions = cache->evictions;
+  unsigned long lookups = cache->hits + cache->misses;
+  stats->hit_rate = lookups ? (double) cache->hits / lookups : 0.0;
+}
@@ -0,0 +1,372 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chash.h"
+
+// A hash table which can be shared between threads, with the same get,
+// put and remove as `hash_t`.
+//
+// Readers never take a lock, and never wait. Slots are published with a
+// release store of their hash, after the key and value have been
+// written, so a reader which sees a hash also sees a complete slot. A removed key keeps its
+// slot (with a NULL value) until the next resize, as moving slots or
+// freeing keys could pull them out from under a reader.
+//
+// Writers lock one of CHASH_STRIPES mutexes, picked by the key's hash,
+// so writers of the same key are serialised and writers of different
+// keys mostly are not. Free slots are claimed with a compare and swap,
+// as writers of different stripes may probe into the same slots.
+//
+// A resize takes every stripe, so it stops all writers, copies the live
+// keys into a new table and publishes it. Readers still in the old table
+// carry on undisturbed, and the old table is freed once they all left.
+//
+// Each thread gets one of CHASH_READERS slots, the same in every table,
+// and makes its sequence odd while reading. As only the thread itself
+// writes it, on a cache line of its own, reads touch nothing other
+// threads write besides the table, and scale with the amount of cores.
+// A resize waits for every slot it saw odd to change. Threads beyond
+// CHASH_READERS fall back on a shared counter per epoch.
+
+// Taken reader slots, given back when their thread exits.
+static pthread_once_t _chash_ids_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _chash_ids_key;
+static pthread_mutex_t _chash_ids_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char _chash_ids_taken[CHASH_READERS];
+static _Thread_local unsigned int _chash_id; // The thread's slot plus one, 0 until known.
+
+static void _chash_id_release(void* id) {
+  pthread_mutex_lock(&_chash_ids_lock);
+  _chash_ids_taken[(size_t) id - 1] = 0;
+  pthread_mutex_unlock(&_chash_ids_lock);
+}
+
+static void _chash_ids_init(void) {
+  pthread_key_create(&_chash_ids_key, _chash_id_release);
+}
+
+// Returns the reader slot of the calling thread, or CHASH_READERS if it
+// found every slot taken, which it then sticks with.
+static unsigned int _chash_reader_id(void) {
+  if (_chash_id != 0) return _chash_id - 1;
+  pthread_once(&_chash_ids_once, _chash_ids_init);
+
+  unsigned int id = 0;
+  pthread_mutex_lock(&_chash_ids_lock);
+  while (id < CHASH_READERS && _chash_ids_taken[id])
+    id++;
+  if (id < CHASH_READERS)
+    _chash_ids_taken[id] = 1;
+  pthread_mutex_unlock(&_chash_ids_lock);
+  // The key's value hands the slot back once the thread exits.
+  if (id < CHASH_READERS && pthread_setspecific(_chash_ids_key, (void*) (size_t) (id + 1)) != 0) {
+    _chash_id_release((void*) (size_t) (id + 1));
+    id = CHASH_READERS;
+  }
+  _chash_id = id + 1;
+  return id;
+}
+
+static unsigned long _chash_key(const chash_t* hash_table, const char* key, size_t len) {
+  unsigned long key_hash = hash_table->hash_func(key, len, hash_table->seed);
+  if (key_hash <= CHASH_BUSY)
+    key_hash += 2;
+  return key_hash;
+}
+
+static pthread_mutex_t* _chash_stripe(chash_t* hash_table, unsigned long key_hash) {
+  // The low bits pick the home slot, use the high ones for the stripe.
+  return &hash_table->stripes[(key_hash >> 24) % CHASH_STRIPES];
+}
+
+static chash_table_t* _chash_table_new(unsigned int size) {
+  unsigned int capacity = 16;
+  while (capacity < size && capacity <= (~0u >> 2))
+    capacity *= 2;
+
+  chash_table_t* table = calloc(1, sizeof(chash_table_t));
+  if (table == NULL) return NULL;
+  table->slots = calloc(capacity, sizeof(chash_slot_t));
+  if (table->slots == NULL) {
+    free(table);
+    return NULL;
+  }
+
+  table->size = capacity;
+  for (unsigned int i = 0; i < capacity; i++) {
+    atomic_init(&table->slots[i].hash, HASH_EMPTY);
+    atomic_init(&table->slots[i].value, NULL);
+  }
+  atomic_init(&table->used, 0);
+  return table;
+}
+
+// Frees the table, and the keys of slots which were not carried over
+// into a newer table (removed keys), or all keys if `all_keys` is set.
+static void _chash_table_free(chash_table_t* table, int all_keys) {
+  for (unsigned int i = 0; i < table->size; i++) {
+    chash_slot_t* slot = &table->slots[i];
+    if (all_keys || atomic_load_explicit(&slot->value, memory_order_relaxed) == NULL)
+      free(slot->key);
+  }
+  free(table->slots);
+  free(table);
+}
+
+chash_t* chash_new(unsigned int size) {
+  chash_t* hash_table = calloc(1, sizeof(chash_t));
+  if (hash_table == NULL) return NULL;
+
+  hash_table->readers = aligned_alloc(CHASH_CACHE_LINE, CHASH_READERS * sizeof(chash_reader_t));
+  chash_table_t* table = _chash_table_new(size);
+  if (hash_table->readers == NULL || table == NULL) {
+    free(hash_table->readers);
+    free(table);
+    free(hash_table);
+    return NULL;
+  }
+
+  atomic_init(&hash_table->table, table);
+  for (int i = 0; i < CHASH_READERS; i++)
+    atomic_init(&hash_table->readers[i].seq, 0);
+  atomic_init(&hash_table->epoch, 0);
+  atomic_init(&hash_table->overflow[0], 0);
+  atomic_init(&hash_table->overflow[1], 0);
+  atomic_init(&hash_table->count, 0);
+  for (int i = 0; i < CHASH_STRIPES; i++)
+    pthread_mutex_init(&hash_table->stripes[i], NULL);
+  // Shared tables are the likeliest to see keys from outside.
+  hash_table->hash_func = hash_wy;
+  hash_table->seed = hash_random_seed();
+  return hash_table;
+}
+
+// NOTE: Like `hash_free`, this does not free any values. No other thread
+// may be using the table anymore.
+void chash_free(chash_t* hash_table) {
+  _chash_table_free(atomic_load(&hash_table->table), 1);
+  for (int i = 0; i < CHASH_STRIPES; i++)
+    pthread_mutex_destroy(&hash_table->stripes[i]);
+  free(hash_table->readers);
+  free(hash_table);
+}
+
+// Registers as a reader of the current epoch, for threads without a
+// slot. Only retries when a resize finishes in between, so a reader can
+// never be blocked by writers.
+static unsigned long _chash_enter_overflow(chash_t* hash_table) {
+  for (;;) {
+    unsigned long epoch = atomic_load(&hash_table->epoch);
+    atomic_fetch_add(&hash_table->overflow[epoch & 1], 1);
+    if (atomic_load(&hash_table->epoch) == epoch)
+      return epoch;
+    atomic_fetch_sub(&hash_table->overflow[epoch & 1], 1);
+  }
+}
+
+// Marks the calling thread as reading, until `_chash_leave` is given the
+// returned value. Must come before loading the table, which the store
+// being sequentially consistent sees to.
+static unsigned long _chash_enter(chash_t* hash_table, unsigned int id) {
+  if (id == CHASH_READERS) return _chash_enter_overflow(hash_table);
+  chash_reader_t* reader = &hash_table->readers[id];
+  unsigned long seq = atomic_load_explicit(&reader->seq, memory_order_relaxed);
+  atomic_store(&reader->seq, seq + 1);
+  return seq + 1;
+}
+
+static void _chash_leave(chash_t* hash_table, unsigned int id, unsigned long entered) {
+  if (id == CHASH_READERS)
+    atomic_fetch_sub(&hash_table->overflow[entered & 1], 1);
+  else
+    atomic_store_explicit(&hash_table->readers[id].seq, entered + 1, memory_order_release);
+}
+
+// Waits until no reader can still be in a table which was just replaced.
+static void _chash_wait_readers(chash_t* hash_table, unsigned long epoch) {
+  for (int i = 0; i < CHASH_READERS; i++) {
+    _Atomic unsigned long* seq = &hash_table->readers[i].seq;
+    unsigned long seen = atomic_load(seq);
+    if (seen & 1)
+      while (atomic_load(seq) == seen)
+        sched_yield();
+  }
+  while (atomic_load(&hash_table->overflow[epoch & 1]) != 0)
+    sched_yield();
+}
+
+static int _chash_slot_is(const chash_slot_t* slot, const char* key, size_t len) {
+  return slot->len == len && memcmp(slot->key, key, len) == 0;
+}
+
+// Returns the slot of a key, or NULL if it was never stored.
+static chash_slot_t* _chash_find(chash_table_t* table, unsigned long key_hash, const char* key, size_t len) {
+  unsigned int mask = table->size - 1;
+  unsigned int i = key_hash & mask;
+  for (unsigned int attempts = table->size; attempts != 0; attempts--) {
+    chash_slot_t* slot = &table->slots[i];
+    unsigned long slot_hash = atomic_load_explicit(&slot->hash, memory_order_acquire);
+    if (slot_hash == HASH_EMPTY) return NULL;
+    if (slot_hash == key_hash && _chash_slot_is(slot, key, len)) return slot;
+    i = (i + 1) & mask;
+  }
+  return NULL;
+}
+
+void* chash_get(chash_t* hash_table, const char* key) {
+  size_t len = strlen(key);
+  unsigned long key_hash = _chash_key(hash_table, key, len);
+
+  unsigned int id = _chash_reader_id();
+  unsigned long entered = _chash_enter(hash_table, id);
+  chash_table_t* table = atomic_load(&hash_table->table);
+  chash_slot_t* slot = _chash_find(table, key_hash, key, len);
+  void* value = slot ? atomic_load_explicit(&slot->value, memory_order_acquire) : NULL;
+  _chash_leave(hash_table, id, entered);
+  return value;
+}
+
+static void _chash_lock_all(chash_t* hash_table) {
+  for (int i = 0; i < CHASH_STRIPES; i++)
+    pthread_mutex_lock(&hash_table->stripes[i]);
+}
+
+static void _chash_unlock_all(chash_t* hash_table) {
+  for (int i = CHASH_STRIPES - 1; i >= 0; i--)
+    pthread_mutex_unlock(&hash_table->stripes[i]);
+}
+
+// Replaces the table with one sized for the live keys, leaving removed
+// keys behind. Must hold every stripe, so no slot changes meanwhile.
+static int _chash_resize(chash_t* hash_table) {
+  chash_table_t* old = atomic_load(&hash_table->table);
+  unsigned int live = atomic_load(&hash_table->count);
+  chash_table_t* table = _chash_table_new((unsigned int) ((live + 1) / (CHASH_MAX_LOAD / 2)));
+  if (table == NULL) return -1;
+
+  unsigned int mask = table->size - 1;
+  for (unsigned int j = 0; j < old->size; j++) {
+    chash_slot_t* from = &old->slots[j];
+    unsigned long key_hash = atomic_load_explicit(&from->hash, memory_order_relaxed);
+    void* value = atomic_load_explicit(&from->value, memory_order_relaxed);
+    if (value == NULL) continue;
+
+    unsigned int i = key_hash & mask;
+    while (atomic_load_explicit(&table->slots[i].hash, memory_order_relaxed) != HASH_EMPTY)
+      i = (i + 1) & mask;
+    // The key now belongs to the new table.
+    table->slots[i].key = from->key;
+    table->slots[i].len = from->len;
+    atomic_store_explicit(&table->slots[i].value, value, memory_order_relaxed);
+    atomic_store_explicit(&table->slots[i].hash, key_hash, memory_order_relaxed);
+    atomic_fetch_add_explicit(&table->used, 1, memory_order_relaxed);
+  }
+
+  // Publish, then wait out everyone who may have seen the old table.
+  unsigned long epoch = atomic_load(&hash_table->epoch);
+  atomic_store(&hash_table->table, table);
+  atomic_store(&hash_table->epoch, epoch + 1);
+  _chash_wait_readers(hash_table, epoch);
+
+  _chash_table_free(old, 0);
+  return 0;
+}
+
+static int _chash_needs_resize(const chash_table_t* table, unsigned int used) {
+  return used + 1 > CHASH_MAX_LOAD * table->size;
+}
+
+// Set and return the value at position key. Values may not be NULL, as
+// that is what marks a removed key.
+void* chash_put(chash_t* hash_table, const char* key, void* value) {
+  if (value == NULL) return NULL;
+  size_t len = strlen(key);
+  unsigned long key_hash = _chash_key(hash_table, key, len);
+  pthread_mutex_t* stripe = _chash_stripe(hash_table, key_hash);
+
+  pthread_mutex_lock(stripe);
+  for (;;) {
+    // The table cannot be replaced while we hold a stripe.
+    chash_table_t* table = atomic_load(&hash_table->table);
+    chash_slot_t* slot = _chash_find(table, key_hash, key, len);
+    if (slot) {
+      if (atomic_exchange(&slot->value, value) == NULL)
+        atomic_fetch_add(&hash_table->count, 1);
+      break;
+    }
+
+    // Reserve a slot first, so writers of other stripes can never claim
+    // more slots between them than the table has room for.
+    unsigned int used = atomic_fetch_add(&table->used, 1);
+    if (_chash_needs_resize(table, used)) {
+      atomic_fetch_sub(&table->used, 1);
+      // Resizing takes every stripe in order, so let go of ours first.
+      pthread_mutex_unlock(stripe);
+      _chash_lock_all(hash_table);
+      int failed = 0;
+      if (atomic_load(&hash_table->table) == table && _chash_needs_resize(table, atomic_load(&table->used)))
+        failed = _chash_resize(hash_table) == -1;
+      _chash_unlock_all(hash_table);
+      pthread_mutex_lock(stripe);
+      if (failed) {
+        value = NULL;
+        break;
+      }
+      continue;
+    }
+
+    char* copy = malloc(len + 1);
+    if (copy == NULL) {
+      atomic_fetch_sub(&table->used, 1);
+      value = NULL;
+      break;
+    }
+    memcpy(copy, key, len + 1);
+
+    // Claim the first empty slot. Writers of other stripes may beat us to
+    // a slot, in which case we keep probing past it.
+    unsigned int mask = table->size - 1;
+    unsigned int i = key_hash & mask;
+    for (;;) {
+      unsigned long expected = HASH_EMPTY;
+      if (atomic_compare_exchange_strong(&table->slots[i].hash, &expected, CHASH_BUSY))
+        break;
+      i = (i + 1) & mask;
+    }
+    slot = &table->slots[i];
+    slot->key = copy;
+    slot->len = len;
+    atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+    atomic_store_explicit(&slot->hash, key_hash, memory_order_release);
+    atomic_fetch_add(&hash_table->count, 1);
+    break;
+  }
+  pthread_mutex_unlock(stripe);
+  return value;
+}
+
+// Remove and return the value at position key.
+void* chash_remove(chash_t* hash_table, const char* key) {
+  size_t len = strlen(key);
+  unsigned long key_hash = _chash_key(hash_table, key, len);
+  pthread_mutex_t* stripe = _chash_stripe(hash_table, key_hash);
+
+  pthread_mutex_lock(stripe);
+  chash_slot_t* slot = _chash_find(atomic_load(&hash_table->table), key_hash, key, len);
+  void* value = slot ? atomic_exchange(&slot->value, NULL) : NULL;
+  if (value)
+    atomic_fetch_sub(&hash_table->count, 1);
+  pthread_mutex_unlock(stripe);
+  return value;
+}
+
+// Returns the count of set keys in the hash table.
+int chash_count(chash_t* hash_table) {
+  return atomic_load(&hash_table->count);
+}
@@ -4,8 +4,12 @@
 // clause) to any licence for distributing derivative works that have
 // been produced by the normal use of the Work as a library.
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "hash.h"
+#include "hash_private.h"
 
 // Implementing the hash function `djb2` as per described by Ozan Yigit
 // at York University's Electrical Engineering and Computer Science
@@ -25,19 +29,127 @@ unsigned long djb2_hash(const char* str) {
   return hash;
 }
 
+// `djb2` as a `hash_func_t`. The seed is mixed into the starting value,
+// so a seed of 0 gives the same hashes as `djb2_hash`.
+unsigned long hash_djb2(const char* key, size_t len, unsigned long seed) {
+  const unsigned char* ukey = (const unsigned char*) key;
+  unsigned long hash = 5381u ^ seed;
+
+  for (size_t i = 0; i < len; i++)
+    hash = ((hash << 5) + hash) + ukey[i];
+
+  return hash;
+}
+
+// Hash of a key as stored in `keys`. The few hashes that would collide
+// with the reserved slot markers are moved out of their way.
+unsigned long _hash_key(const hash_t* hash_table, const char* key, size_t len) {
+  unsigned long key_hash = hash_table->hash_func(key, len, hash_table->seed);
+  if (key_hash <= HASH_TOMBSTONE)
+    key_hash += 2;
+  return key_hash;
+}
+
+// Allocates empty arrays for `size` slots, replacing whatever arrays the
+// table pointed to before.
+static int _hash_alloc_slots(hash_t* hash_table, unsigned int size) {
+  int own_keys = (hash_table->flags & HASH_OWN_KEYS) != 0;
+  unsigned long* keys = NULL;
+  void** values = NULL;
+  size_t* key_refs = NULL;
+  signed char* ctrl = NULL;
+  unsigned long long* filter = NULL;
+  unsigned int filter_mask = 0;
+  char* slots = NULL;
+  size_t stride = 0;
+  if (hash_table->flags & HASH_INTERLEAVED) {
+    stride = own_keys ? sizeof(_hash_slot_t) : offsetof(_hash_slot_t, key_ref);
+    slots = calloc(size, stride);
+    if (slots) {
+      keys = (unsigned long*) (slots + offsetof(_hash_slot_t, key));
+      values = (void**) (slots + offsetof(_hash_slot_t, value));
+      if (own_keys)
+        key_refs = (size_t*) (slots + offsetof(_hash_slot_t, key_ref));
+    }
+  } else {
+    keys = calloc(size, sizeof(unsigned long));
+    values = calloc(size, sizeof(void*));
+    if (own_keys)
+      key_refs = calloc(size, sizeof(size_t));
+  }
+  if (hash_table->flags & HASH_SWISS)
+    ctrl = malloc(size);
+  if (hash_table->flags & HASH_FILTER)
+    filter = _hash_filter_alloc(size, &filter_mask);
+  if (keys == NULL || values == NULL
+      || (own_keys && key_refs == NULL)
+      || (hash_table->flags & HASH_SWISS && ctrl == NULL)
+      || (hash_table->flags & HASH_FILTER && filter == NULL)) {
+    if (slots) {
+      free(slots);
+    } else {
+      free(keys);
+      free(values);
+      free(key_refs);
+    }
+    free(ctrl);
+    free(filter);
+    return -1;
+  }
+
+  if (ctrl)
+    memset(ctrl, _HASH_CTRL_EMPTY, size);
+
+  hash_table->key_stride = stride ? stride : sizeof(unsigned long);
+  hash_table->value_stride = stride ? stride : sizeof(void*);
+  hash_table->ref_stride = stride ? stride : sizeof(size_t);
+  hash_table->keys = keys;
+  for (unsigned int i = 0; i < size; i++)
+    _HASH_KEY(hash_table, i) = HASH_EMPTY;
+
+  hash_table->size = size;
+  hash_table->values = values;
+  hash_table->key_refs = key_refs;
+  hash_table->ctrl = ctrl;
+  hash_table->filter = filter;
+  hash_table->filter_mask = filter_mask;
+  hash_table->filter_stale = 0;
+  hash_table->count = 0;
+  hash_table->tombstones = 0;
+  hash_table->displaced = 0;
+  hash_table->max_probe = 0;
+  hash_table->probe_total = 0;
+  hash_table->arena = NULL;
+  hash_table->arena_len = 0;
+  hash_table->arena_cap = 0;
+  hash_table->arena_garbage = 0;
+  return 0;
+}
+
 hash_t* hash_new(unsigned int size) {
+  return hash_new_flags(size, 0);
+}
+
+hash_t* hash_new_flags(unsigned int size, unsigned int flags) {
   hash_t* hash_table = calloc(1, sizeof(hash_t));
   if (hash_table == NULL)
     goto malloc_fail;
 
-  hash_table->size = size;
-  hash_table->keys = calloc(size, sizeof(unsigned long));
-  hash_table->values = calloc(size, sizeof(void*));
-  if (hash_table->keys == NULL || hash_table->values == NULL)
-    goto malloc_fail;
+  // A growable table has to be able to double, even when started empty.
+  if (flags & HASH_GROWABLE && size == 0)
+    size = 1;
+  if (flags & HASH_SWISS)
+    size = _hash_swiss_capacity(size);
 
-  for (unsigned int i = 0; i < size; i++)
-    hash_table->keys[i] = 0;
+  hash_table->flags = flags;
+  hash_table->max_load = HASH_DEFAULT_MAX_LOAD;
+  hash_table->hash_func = hash_djb2;
+  if (flags & HASH_SEEDED) {
+    hash_table->hash_func = hash_wy;
+    hash_table->seed = hash_random_seed();
+  }
+  if (_hash_alloc_slots(hash_table, size) == -1)
+    goto malloc_fail;
   return hash_table;
 
   malloc_fail:
@@ -46,87 +158,547 @@ hash_t* hash_new(unsigned int size) {
   return NULL;
 }
 
+// Sets the load factor a growable table will resize at, in (0, 1].
+void hash_set_max_load(hash_t* hash_table, double max_load) {
+  if (max_load > 0.0 && max_load <= 1.0)
+    hash_table->max_load = max_load;
+}
+
+// Changes the hash function of an empty table, as the hashes of keys
+// already stored would no longer match. Returns -1 if not empty.
+int hash_set_func(hash_t* hash_table, hash_func_t hash_func, unsigned long seed) {
+  if (hash_table->count != 0 || hash_table->tombstones != 0 || hash_table->draining
+      || hash_table->mapping)
+    return -1;
+  hash_table->hash_func = hash_func;
+  hash_table->seed = seed;
+  return 0;
+}
+
 // NOTE: We do not free any values, just the array holding the pointers
 // to the valuees. This is because we cannot know what values were
 // possibly allocated dynamically.
 void hash_free(hash_t* hash_table) {
-  free(hash_table->values);
+  if (hash_table->mapping) {
+    _hash_unmap(hash_table);
+    free(hash_table);
+    return;
+  }
+  if (hash_table->draining)
+    hash_free(hash_table->draining);
+  free(hash_table->ctrl);
+  free(hash_table->filter);
+  free(hash_table->arena);
+  // Interleaved slots are one allocation, starting with the first key.
+  if (!(hash_table->flags & HASH_INTERLEAVED)) {
+    free(hash_table->key_refs);
+    free(hash_table->values);
+  }
   free(hash_table->keys);
   free(hash_table);
 }
 
-int _hash_desired_index(const hash_t* hash_table, const char* key) {
-  unsigned long key_hash = djb2_hash(key);
+static const char* _hash_stored_key(const hash_t* hash_table, unsigned int i, size_t* len) {
+  const char* entry = hash_table->arena + _HASH_KEY_REF(hash_table, i);
+  unsigned int stored_len;
+  memcpy(&stored_len, entry, sizeof(stored_len));
+  *len = stored_len;
+  return entry + sizeof(stored_len);
+}
+
+// Only called once the hashes are known to match. Without owned keys we
+// have nothing more to compare, so equal hashes means equal keys.
+int _hash_key_equal(const hash_t* hash_table, unsigned int i, const char* key, size_t len) {
+  if (!(hash_table->flags & HASH_OWN_KEYS)) return 1;
+  size_t stored_len;
+  const char* stored = _hash_stored_key(hash_table, i, &stored_len);
+  return stored_len == len && memcmp(stored, key, len) == 0;
+}
+
+// Rewrites the arena with only the keys still in use.
+static int _hash_compact_arena(hash_t* hash_table) {
+  size_t cap = hash_table->arena_len - hash_table->arena_garbage;
+  char* arena = malloc(cap > 0 ? cap : 1);
+  if (arena == NULL) return -1;
+
+  size_t arena_len = 0;
+  for (unsigned int i = 0; i < hash_table->size; i++) {
+    if (_HASH_KEY(hash_table, i) <= HASH_TOMBSTONE) continue;
+    size_t len;
+    const char* key = _hash_stored_key(hash_table, i, &len);
+    size_t entry_size = _HASH_ENTRY_SIZE(len);
+    memcpy(arena + arena_len, key - sizeof(unsigned int), entry_size);
+    _HASH_KEY_REF(hash_table, i) = arena_len;
+    arena_len += entry_size;
+  }
+
+  free(hash_table->arena);
+  hash_table->arena = arena;
+  hash_table->arena_len = arena_len;
+  hash_table->arena_cap = cap;
+  hash_table->arena_garbage = 0;
+  return 0;
+}
+
+// Copies the key into the arena and points slot `i` at it.
+static int _hash_store_key(hash_t* hash_table, unsigned int i, const char* key, size_t len) {
+  if (!(hash_table->flags & HASH_OWN_KEYS)) return 0;
+  if (len > UINT_MAX) return -1;
+
+  size_t entry_size = _HASH_ENTRY_SIZE(len);
+  if (hash_table->arena_len + entry_size > hash_table->arena_cap) {
+    // Reclaim removed keys before growing, when they make up half of it.
+    if (hash_table->arena_garbage > hash_table->arena_len / 2)
+      if (_hash_compact_arena(hash_table) == -1) return -1;
+  }
+  if (hash_table->arena_len + entry_size > hash_table->arena_cap) {
+    size_t cap = hash_table->arena_cap * 2;
+    if (cap < hash_table->arena_len + entry_size)
+      cap = hash_table->arena_len + entry_size + 64;
+    char* arena = realloc(hash_table->arena, cap);
+    if (arena == NULL) return -1;
+    hash_table->arena = arena;
+    hash_table->arena_cap = cap;
+  }
+
+  unsigned int stored_len = (unsigned int) len;
+  char* entry = hash_table->arena + hash_table->arena_len;
+  memcpy(entry, &stored_len, sizeof(stored_len));
+  memcpy(entry + sizeof(stored_len), key, len);
+  entry[sizeof(stored_len) + len] = '\0';
+  _HASH_KEY_REF(hash_table, i) = hash_table->arena_len;
+  hash_table->arena_len += entry_size;
+  return 0;
+}
+
+// Marks the key of slot `i` as no longer used.
+static void _hash_drop_key(hash_t* hash_table, unsigned int i) {
+  if (!(hash_table->flags & HASH_OWN_KEYS)) return;
+  size_t len;
+  (void) _hash_stored_key(hash_table, i, &len);
+  hash_table->arena_garbage += _HASH_ENTRY_SIZE(len);
+}
+
+static int _hash_linear_probe(const hash_t* hash_table, unsigned long key_hash, const char* key, size_t len) {
   int i = key_hash % hash_table->size;
   // Avoid case of infinite looping when hash table is full and asking
   // for non-existent key.
   int attempts = hash_table->size;
-  while(attempts != 0 && hash_table->keys[i] != 0 && hash_table->keys[i] != key_hash) {
-    // Linear probing, as we hit a valid key which is not ours.
+  while (attempts != 0 && _HASH_KEY(hash_table, i) != HASH_EMPTY) {
+    // The key compare only runs on a hash match, which is rare for
+    // anything but the key we are looking for.
+    if (_HASH_KEY(hash_table, i) == key_hash && _hash_key_equal(hash_table, i, key, len))
+      break;
+    // Linear probing, as we hit a valid key (or tombstone) which is not ours.
     i = (i + 1) % hash_table->size;
     attempts -= 1;
   }
   if (attempts == 0) return -1; // We are full. Sorry :(
-  return i; // This position is correct for this key (empty or exact hash)!
+  return i; // This position is correct for this key (empty or exact key)!
+}
+
+// Returns the slot holding the key, otherwise the slot it should be
+// inserted at, or -1 when there is no room for it.
+int _hash_probe(const hash_t* hash_table, unsigned long key_hash, const char* key, size_t len) {
+  if (hash_table->ctrl)
+    return _hash_swiss_probe(hash_table, key_hash, key, len);
+  return _hash_linear_probe(hash_table, key_hash, key, len);
+}
+
+static int _hash_find(const hash_t* hash_table, unsigned long key_hash, const char* key, size_t len) {
+  // Most keys not in the table never get to probe.
+  if (hash_table->filter && !_hash_filter_may_have(hash_table, key_hash)) return -1;
+  int i = _hash_probe(hash_table, key_hash, key, len);
+  if (i == -1 || _HASH_KEY(hash_table, i) <= HASH_TOMBSTONE) return -1;
+  return i;
 }
 
+// How far slot `i` is from the first slot (or group) its key probes.
+unsigned int _hash_displacement(const hash_t* hash_table, unsigned int i) {
+  if (hash_table->ctrl)
+    return _hash_swiss_displacement(hash_table, i);
+  unsigned int home = _HASH_KEY(hash_table, i) % hash_table->size;
+  return (i + hash_table->size - home) % hash_table->size;
+}
+
+// Keeps the probe statistics up to date as keys come and go, so that
+// `hash_stats` never has to scan the table.
+static void _hash_track(hash_t* hash_table, unsigned int i, int added) {
+  unsigned int displacement = _hash_displacement(hash_table, i);
+  if (added) {
+    hash_table->probe_total += displacement;
+    hash_table->displaced += displacement != 0;
+    if (displacement + 1 > hash_table->max_probe)
+      hash_table->max_probe = displacement + 1;
+  } else {
+    hash_table->probe_total -= displacement;
+    hash_table->displaced -= displacement != 0;
+  }
+}
+
+void _hash_occupy(hash_t* hash_table, unsigned int i, unsigned long key_hash) {
+  if (hash_table->ctrl)
+    _hash_swiss_set(hash_table, i, key_hash);
+  else
+    _HASH_KEY(hash_table, i) = key_hash;
+  if (hash_table->filter)
+    _hash_filter_add(hash_table, key_hash);
+  hash_table->count += 1;
+  _hash_track(hash_table, i, 1);
+}
+
+// Empties a slot without moving any other slots around.
+static void _hash_vacate(hash_t* hash_table, unsigned int i) {
+  _hash_track(hash_table, i, 0);
+  _hash_drop_key(hash_table, i);
+  if (hash_table->ctrl) {
+    _hash_swiss_erase(hash_table, i);
+  } else {
+    _HASH_KEY(hash_table, i) = HASH_TOMBSTONE;
+    hash_table->tombstones += 1;
+  }
+  _HASH_VALUE(hash_table, i) = NULL;
+  hash_table->count -= 1;
+}
+
+// Moves slot `from` into the empty slot `to`.
+static void _hash_linear_move(hash_t* hash_table, unsigned int to, unsigned int from) {
+  _hash_track(hash_table, from, 0);
+  _HASH_KEY(hash_table, to) = _HASH_KEY(hash_table, from);
+  _HASH_VALUE(hash_table, to) = _HASH_VALUE(hash_table, from);
+  if (hash_table->flags & HASH_OWN_KEYS)
+    _HASH_KEY_REF(hash_table, to) = _HASH_KEY_REF(hash_table, from);
+  _hash_track(hash_table, to, 1);
+}
+
+// Backward shift deletion, as per Knuth's Algorithm R (TAOCP vol. 3,
+// 6.4). After emptying slot `i`, the rest of its cluster is walked, and
+// any key which could no longer be reached past the hole is moved into
+// it, leaving a new hole behind. A key may stay where it is only if its
+// home slot lies cyclically within (hole, current]. This leaves no
+// tombstones, so probes stay as short as if the key was never there.
+static void _hash_linear_erase(hash_t* hash_table, unsigned int i) {
+  unsigned int size = hash_table->size;
+  _hash_track(hash_table, i, 0);
+  _hash_drop_key(hash_table, i);
+
+  unsigned int j = i;
+  for (unsigned int attempts = size - 1; attempts != 0; attempts--) {
+    j = (j + 1) % size;
+    if (_HASH_KEY(hash_table, j) == HASH_EMPTY) break;
+
+    unsigned int home = _HASH_KEY(hash_table, j) % size;
+    int reachable = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+    if (reachable) continue;
+
+    _hash_linear_move(hash_table, i, j);
+    i = j;
+  }
+
+  _HASH_KEY(hash_table, i) = HASH_EMPTY;
+  _HASH_VALUE(hash_table, i) = NULL;
+  hash_table->count -= 1;
+}
+
+// Removes a key from a draining table. Nothing may be shifted around
+// there, as that could move entries past `drain_pos`.
+static void* _hash_drain_remove(hash_t* old, unsigned long key_hash, const char* key, size_t len) {
+  int i = _hash_find(old, key_hash, key, len);
+  if (i == -1) return NULL;
+
+  void* value = _HASH_VALUE(old, i);
+  _hash_vacate(old, i);
+  return value;
+}
+
+// Moves up to `steps` slots from the draining table into the current one.
+static void _hash_drain(hash_t* hash_table, unsigned int steps) {
+  hash_t* old = hash_table->draining;
+  for (; steps != 0 && hash_table->drain_pos < old->size; steps--) {
+    unsigned int j = hash_table->drain_pos;
+    if (_HASH_KEY(old, j) > HASH_TOMBSTONE) {
+      const char* key = NULL;
+      size_t len = 0;
+      if (old->flags & HASH_OWN_KEYS)
+        key = _hash_stored_key(old, j, &len);
+
+      // Keys only ever live in one of the tables, so this is a free slot.
+      int i = _hash_probe(hash_table, _HASH_KEY(old, j), key, len);
+      // Out of memory, try again on the next step.
+      if (_hash_store_key(hash_table, i, key, len) == -1) return;
+      _hash_occupy(hash_table, i, _HASH_KEY(old, j));
+      _HASH_VALUE(hash_table, i) = _HASH_VALUE(old, j);
+
+      _hash_vacate(old, j);
+    }
+    hash_table->drain_pos += 1;
+  }
+
+  if (hash_table->drain_pos == old->size) {
+    hash_free(old);
+    hash_table->draining = NULL;
+    hash_table->drain_pos = 0;
+  }
+}
+
+static unsigned int _hash_live_count(const hash_t* hash_table) {
+  unsigned int count = hash_table->count;
+  if (hash_table->draining)
+    count += hash_table->draining->count;
+  return count;
+}
+
+// Slots to move over on each change while draining, so that the draining
+// table is empty before enough keys are added to start the next resize.
+// Usually HASH_REHASH_STEP, but more the less room there is left, as with
+// a low max load, or a table still half full of tombstones.
+static unsigned int _hash_drain_steps(const hash_t* hash_table) {
+  size_t left = hash_table->draining->size - hash_table->drain_pos;
+  double room = hash_table->max_load * hash_table->size
+                - _hash_live_count(hash_table) - hash_table->tombstones;
+  size_t keys = room >= 1.0 ? (size_t) room : 1;
+  size_t steps = (left + keys - 1) / keys;
+  return steps > HASH_REHASH_STEP ? (unsigned int) steps : HASH_REHASH_STEP;
+}
+
+static void _hash_step(hash_t* hash_table) {
+  if (hash_table->draining)
+    _hash_drain(hash_table, _hash_drain_steps(hash_table));
+}
+
+// Finishes any resize in one go. Returns -1 if Malloc fails, leaving the
+// table still draining.
+int _hash_settle(hash_t* hash_table) {
+  if (hash_table->draining)
+    _hash_drain(hash_table, hash_table->draining->size);
+  return hash_table->draining ? -1 : 0;
+}
+
+// Doubles the table, or rebuilds it at the same size when it is mostly
+// tombstones. The old arrays become the draining table, which later puts
+// and removes move over bit by bit. Gets only read, and look in both.
+static int _hash_grow(hash_t* hash_table) {
+  // Only one resize at a time. The previous one is done by now, unless
+  // Malloc failed while draining, so finish it off.
+  if (hash_table->draining) {
+    _hash_drain(hash_table, hash_table->draining->size);
+    if (hash_table->draining) return -1;
+  }
+  unsigned int size = hash_table->size;
+  if (hash_table->count + 1 > hash_table->max_load * size / 2) {
+    if (size > INT_MAX / 2) return -1;
+    size *= 2;
+  }
+
+  hash_t* old = malloc(sizeof(hash_t));
+  if (old == NULL) return -1;
+  *old = *hash_table;
+  if (_hash_alloc_slots(hash_table, size) == -1) {
+    free(old);
+    return -1;
+  }
+
+  old->flags &= ~HASH_GROWABLE;
+  hash_table->draining = old;
+  hash_table->drain_pos = 0;
+  return 0;
+}
+
+int _hash_desired_index(const hash_t* hash_table, const char* key) {
+  size_t len = strlen(key);
+  return _hash_probe(hash_table, _hash_key(hash_table, key, len), key, len);
+}
+
+// NOTE: Only looks in the current arrays, a growable table may still
+// hold the key in its draining table.
 int hash_index(const hash_t* hash_table, const char* key) {
-  unsigned long key_hash = djb2_hash(key);
-  int i = _hash_desired_index(hash_table, key);
-  if (hash_table->keys[i] != key_hash) return -1; // Key does not exist. :(
-  return i; // Exact key exists here! :)
+  size_t len = strlen(key);
+  return _hash_find(hash_table, _hash_key(hash_table, key, len), key, len);
+}
+
+// Looks up an already hashed key, in the current and draining table.
+static void* _hash_get_hashed(const hash_t* hash_table, unsigned long key_hash, const char* key, size_t len) {
+  int i = _hash_find(hash_table, key_hash, key, len);
+  if (i != -1) {
+    // Values of a loaded snapshot are offsets to their encoded bytes.
+    if (hash_table->mapped_values)
+      return (void*) (hash_table->mapped_values + (uintptr_t) _HASH_VALUE(hash_table, i));
+    return _HASH_VALUE(hash_table, i);
+  }
+
+  const hash_t* old = hash_table->draining;
+  if (old == NULL) return NULL;
+  i = _hash_find(old, key_hash, key, len);
+  if (i == -1) return NULL;
+  return _HASH_VALUE(old, i);
+}
+
+// Stores an already hashed key, returning the slot it went into, or -1
+// if there was no room for it.
+static int _hash_put_hashed(hash_t* hash_table, unsigned long key_hash, const char* key, size_t len, void* value) {
+  int i = _hash_probe(hash_table, key_hash, key, len);
+  if (i == -1 || _HASH_KEY(hash_table, i) <= HASH_TOMBSTONE) {
+    // A new key, check if we have room for it first. Tombstones count
+    // against the load, as they lengthen probes just the same.
+    unsigned int used = _hash_live_count(hash_table) + hash_table->tombstones;
+    if (hash_table->flags & HASH_GROWABLE
+        && used + 1 > hash_table->max_load * hash_table->size) {
+      _hash_grow(hash_table);
+      i = _hash_probe(hash_table, key_hash, key, len);
+    }
+  }
+  if (i == -1) return -1; // We are full, sorry :(
+
+  if (_HASH_KEY(hash_table, i) <= HASH_TOMBSTONE) {
+    if (_hash_store_key(hash_table, i, key, len) == -1) return -1;
+    if (hash_table->draining)
+      (void) _hash_drain_remove(hash_table->draining, key_hash, key, len);
+    _hash_occupy(hash_table, i, key_hash);
+  }
+  _HASH_VALUE(hash_table, i) = value;
+  return i;
 }
 
 // Return a value found at position key.
+// Never changes the table, so any amount of threads may look up keys at
+// once, as long as none of them changes it.
 void* hash_get(const hash_t* hash_table, const char* key) {
-  int i = hash_index(hash_table, key);
-  if (i == -1) return NULL;
-  return hash_table->values[i];
+  size_t len = strlen(key);
+  return _hash_get_hashed(hash_table, _hash_key(hash_table, key, len), key, len);
 }
 
-// Set and return the value at position key.
+// Set and return the value at position key. Returns NULL if there is no
+// room for it, or if the table is a loaded snapshot.
 void* hash_put(hash_t* hash_table, const char* key, void* value) {
-  unsigned long key_hash = djb2_hash(key);
-  int i = _hash_desired_index(hash_table, key);
-  if (i == -1) return NULL; // We are full, sorry :(
+  if (hash_table->mapping) return NULL;
+  size_t len = strlen(key);
+  unsigned long key_hash = _hash_key(hash_table, key, len);
+  _hash_step(hash_table);
 
-  hash_table->keys[i] = djb2_hash(key);
-  hash_table->values[i] = value;
+  int i = _hash_put_hashed(hash_table, key_hash, key, len, value);
+  if (i == -1) return NULL;
+  return _HASH_VALUE(hash_table, i);
+}
 
-  return hash_table->values[i];
+// Asks the CPU to start loading the slots a key's probe begins at.
+static void _hash_prefetch(const hash_t* hash_table, unsigned long key_hash) {
+  unsigned int home;
+  if (hash_table->ctrl) {
+    home = _hash_swiss_home(hash_table, key_hash);
+    _HASH_PREFETCH(hash_table->ctrl + home);
+  } else {
+    home = key_hash % hash_table->size;
+  }
+  _HASH_PREFETCH(&_HASH_KEY(hash_table, home));
+  if (hash_table->filter)
+    _hash_filter_prefetch(hash_table, key_hash);
+  if (!(hash_table->flags & HASH_INTERLEAVED))
+    _HASH_PREFETCH(&_HASH_VALUE(hash_table, home));
 }
 
-// Remove and return the value at position key.
-void* hash_remove(hash_t* hash_table, const char* key) {
-  int i = hash_index(hash_table, key);
-  if (i == -1) return NULL;
+static size_t _hash_batch_len(size_t n, size_t start) {
+  return n - start < HASH_BATCH ? n - start : HASH_BATCH;
+}
 
-  int orig_i = i;
-  void* tmp = NULL;
-  // Linear probe to test if there exists further hashes after us which use the same key.
-  while (orig_i == hash_table->keys[i + 1] % hash_table->size) {
-    hash_table->keys[i] = hash_table->keys[i + 1];
+// Looks up `n` keys, storing each value (or NULL) in `values`. A batch
+// of keys is hashed and prefetched before any of them are probed, so
+// the cache misses of different keys overlap instead of queueing up.
+void hash_get_many(const hash_t* hash_table, const char* const* keys, size_t n, void** values) {
+  unsigned long hashes[HASH_BATCH];
+  size_t lens[HASH_BATCH];
 
-    // Shift our value forwards.
-    tmp = hash_table->values[i];
-    hash_table->values[i] = hash_table->values[i + 1];
-    hash_table->values[i + 1] = tmp;
+  for (size_t start = 0; start < n; start += HASH_BATCH) {
+    size_t batch = _hash_batch_len(n, start);
+    for (size_t b = 0; b < batch; b++) {
+      lens[b] = strlen(keys[start + b]);
+      hashes[b] = _hash_key(hash_table, keys[start + b], lens[b]);
+      _hash_prefetch(hash_table, hashes[b]);
+    }
+    for (size_t b = 0; b < batch; b++)
+      values[start + b] = _hash_get_hashed(hash_table, hashes[b], keys[start + b], lens[b]);
+  }
+}
+
+// Stores `n` keys with their values, batched as in `hash_get_many`.
+// Returns the amount of keys stored, which is less than `n` if the table
+// ran out of room.
+size_t hash_put_many(hash_t* hash_table, const char* const* keys, void* const* values, size_t n) {
+  unsigned long hashes[HASH_BATCH];
+  size_t lens[HASH_BATCH];
+  size_t stored = 0;
+  if (hash_table->mapping) return 0;
+
+  for (size_t start = 0; start < n; start += HASH_BATCH) {
+    size_t batch = _hash_batch_len(n, start);
+    if (hash_table->draining)
+      _hash_drain(hash_table, _hash_drain_steps(hash_table) * (unsigned int) batch);
+
+    for (size_t b = 0; b < batch; b++) {
+      lens[b] = strlen(keys[start + b]);
+      hashes[b] = _hash_key(hash_table, keys[start + b], lens[b]);
+      _hash_prefetch(hash_table, hashes[b]);
+    }
+    for (size_t b = 0; b < batch; b++)
+      if (_hash_put_hashed(hash_table, hashes[b], keys[start + b], lens[b], values[start + b]) != -1)
+        stored += 1;
+  }
+  return stored;
+}
+
+// Remove and return the value at position key.
+void* hash_remove(hash_t* hash_table, const char* key) {
+  if (hash_table->mapping) return NULL;
+  size_t len = strlen(key);
+  unsigned long key_hash = _hash_key(hash_table, key, len);
+  _hash_step(hash_table);
 
-    i++;
+  int i = _hash_find(hash_table, key_hash, key, len);
+  if (i == -1) {
+    if (hash_table->draining)
+      return _hash_drain_remove(hash_table->draining, key_hash, key, len);
+    return NULL;
   }
 
-  hash_table->keys[i] = 0;
-  void* value = hash_table->values[i];
-  hash_table->values[i] = NULL;
+  void* value = _HASH_VALUE(hash_table, i);
+  if (hash_table->ctrl)
+    _hash_vacate(hash_table, i);
+  else
+    _hash_linear_erase(hash_table, i);
+  if (hash_table->filter)
+    _hash_filter_removed(hash_table);
   return value;
 }
 
 // Returns the count of set keys in the hash table.
-int hash_count(hash_t* hash_table) {
-  int count = 0;
-  for(unsigned int i = 0; i < hash_table->size; i++)
-    if (hash_table->keys[i] != 0)
-      count += 1;
-
+int hash_count(const hash_t* hash_table) {
+  unsigned int count = hash_table->count;
+  if (hash_table->draining)
+    count += hash_table->draining->count;
   return count;
 }
+
+// Fills in statistics on how well the table is doing, from counters kept
+// up to date on every change. A growable table in the middle of a resize
+// reports on both of its tables together.
+void hash_stats(const hash_t* hash_table, hash_stats_t* stats) {
+  stats->size = hash_table->size;
+  stats->count = hash_table->count;
+  stats->tombstones = hash_table->tombstones;
+  stats->displaced = hash_table->displaced;
+  stats->max_probe = hash_table->max_probe;
+  unsigned long probe_total = hash_table->probe_total;
+
+  const hash_t* old = hash_table->draining;
+  if (old) {
+    stats->count += old->count;
+    stats->tombstones += old->tombstones;
+    stats->displaced += old->displaced;
+    if (old->max_probe > stats->max_probe)
+      stats->max_probe = old->max_probe;
+    probe_total += old->probe_total;
+  }
+
+  stats->load_factor = stats->size ? (double) stats->count / stats->size : 0.0;
+  // Every key takes one probe, plus one for every slot it was displaced.
+  stats->mean_probe = stats->count ? 1.0 + (double) probe_total / stats->count : 0.0;
+}
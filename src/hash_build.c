@@ -0,0 +1,372 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "hash.h"
+#include "hash_private.h"
+
+// Builds a table out of arrays of keys and values in one go, spreading
+// the work over several threads. Every key is hashed once, and the table
+// is sized for all of them up front, so it never resizes.
+//
+// The slots are split into one range per thread, and each key goes to
+// the range its probe starts in (its home slot, or home group for
+// HASH_SWISS tables). Threads then each insert the keys of their own
+// range, without any locking, as no probe is allowed past the end of the
+// range it started in. The few keys which would need to, because their
+// home is close to the end of a crowded range, are left for a last pass
+// on the calling thread, which probes normally.
+//
+// It goes in four steps, with the threads joined after each:
+//
+//   1. Hash each key, and count how many go to each range.
+//   2. Copy each key into the arena (for HASH_OWN_KEYS tables), and
+//      scatter the keys to the list of their range.
+//   3. Insert the keys of each range.
+//   4. Insert the keys left over, on the calling thread.
+//
+// Steps 1 and 2 split the keys in chunks, in order, and keep that order
+// in the lists of each range. A key given more than once always starts
+// its probe in the same range, so the last of its values wins, as with
+// repeated puts.
+
+typedef struct HashBuild {
+  hash_t* hash_table;
+  const char* const* keys;
+  void* const* values;
+  size_t n;
+  unsigned int threads;
+
+  // Of each key.
+  unsigned long* hashes;
+  size_t* lens;
+  size_t* refs; // Offset of the key in the arena.
+
+  // Slots of each range, which is a whole amount of groups for
+  // HASH_SWISS tables.
+  unsigned int range_slots;
+  // `counts[t * threads + r]` is the amount of keys of chunk `t` going
+  // to range `r`, which step 1 counts and step 2 turns into where they
+  // go in `order`.
+  size_t* counts;
+  size_t* arena_bytes; // Arena bytes of the keys of each chunk.
+  // Keys by range, with `starts[r]` being where those of range `r` start.
+  unsigned int* order;
+  size_t* starts;
+
+  // What each range did in step 3.
+  struct HashBuildRange {
+    size_t deferred; // Left for step 4, at the start of its list.
+    unsigned int count;
+    unsigned int displaced;
+    unsigned int max_probe;
+    unsigned long probe_total;
+    size_t garbage; // Arena bytes of keys given more than once.
+  }* ranges;
+} _hash_build_t;
+
+typedef struct HashBuildTask {
+  _hash_build_t* build;
+  unsigned int t;
+  void (*step)(_hash_build_t* build, unsigned int t);
+} _hash_build_task_t;
+
+static size_t _build_chunk_start(const _hash_build_t* build, unsigned int t) {
+  return build->n / build->threads * t + (t < build->n % build->threads ? t : build->n % build->threads);
+}
+
+static unsigned int _build_home(const hash_t* hash_table, unsigned long key_hash) {
+  if (hash_table->ctrl)
+    return _hash_swiss_home(hash_table, key_hash);
+  return key_hash % hash_table->size;
+}
+
+static unsigned int _build_range(const _hash_build_t* build, unsigned long key_hash) {
+  return _build_home(build->hash_table, key_hash) / build->range_slots;
+}
+
+static void _build_hash_step(_hash_build_t* build, unsigned int t) {
+  size_t* counts = build->counts + (size_t) t * build->threads;
+  size_t arena_bytes = 0;
+  for (size_t i = _build_chunk_start(build, t); i < _build_chunk_start(build, t + 1); i++) {
+    size_t len = strlen(build->keys[i]);
+    build->lens[i] = len;
+    build->hashes[i] = _hash_key(build->hash_table, build->keys[i], len);
+    arena_bytes += _HASH_ENTRY_SIZE(len);
+    counts[_build_range(build, build->hashes[i])] += 1;
+  }
+  build->arena_bytes[t] = arena_bytes;
+}
+
+static void _build_scatter_step(_hash_build_t* build, unsigned int t) {
+  size_t* counts = build->counts + (size_t) t * build->threads;
+  int own_keys = (build->hash_table->flags & HASH_OWN_KEYS) != 0;
+  size_t ref = build->arena_bytes[t];
+  for (size_t i = _build_chunk_start(build, t); i < _build_chunk_start(build, t + 1); i++) {
+    if (own_keys) {
+      unsigned int stored_len = (unsigned int) build->lens[i];
+      char* entry = build->hash_table->arena + ref;
+      memcpy(entry, &stored_len, sizeof(stored_len));
+      memcpy(entry + sizeof(stored_len), build->keys[i], build->lens[i] + 1);
+      build->refs[i] = ref;
+      ref += _HASH_ENTRY_SIZE(build->lens[i]);
+    }
+    build->order[counts[_build_range(build, build->hashes[i])]++] = (unsigned int) i;
+  }
+}
+
+// Looks for the key, or a slot to put it in, without leaving the range
+// `[first, end)`. Returns -1 if the probe would have to go further.
+static int _build_probe(const hash_t* hash_table, unsigned int first, unsigned int end,
+                        unsigned long key_hash, const char* key, size_t len) {
+  if (hash_table->ctrl) {
+    // Only the home group, as nothing was ever deleted.
+    int empty = -1;
+    for (unsigned int i = first; i < first + HASH_SWISS_GROUP; i++) {
+      if (hash_table->ctrl[i] == _HASH_CTRL_EMPTY) {
+        if (empty == -1) empty = (int) i;
+      } else if (_HASH_KEY(hash_table, i) == key_hash && _hash_key_equal(hash_table, i, key, len)) {
+        return (int) i;
+      }
+    }
+    return empty;
+  }
+  for (unsigned int i = first; i < end; i++) {
+    unsigned long slot_key = _HASH_KEY(hash_table, i);
+    if (slot_key == HASH_EMPTY
+        || (slot_key == key_hash && _hash_key_equal(hash_table, i, key, len)))
+      return (int) i;
+  }
+  return -1;
+}
+
+static void _build_insert_step(_hash_build_t* build, unsigned int r) {
+  hash_t* hash_table = build->hash_table;
+  struct HashBuildRange* range = &build->ranges[r];
+  unsigned int first = r * build->range_slots;
+  unsigned int end = first + build->range_slots;
+  if (end > hash_table->size || end < first)
+    end = hash_table->size;
+
+  size_t start = build->starts[r];
+  size_t deferred = 0;
+  for (size_t o = start; o < build->starts[r + 1]; o++) {
+    unsigned int k = build->order[o];
+    unsigned long key_hash = build->hashes[k];
+    unsigned int home = _build_home(hash_table, key_hash);
+    int i = _build_probe(hash_table, home, end, key_hash, build->keys[k], build->lens[k]);
+    if (i == -1) {
+      // Keys already looked at are never looked at again, so there is
+      // room at the start of the list to keep the ones left for later.
+      build->order[start + deferred++] = k;
+      continue;
+    }
+
+    if (_HASH_KEY(hash_table, i) > HASH_TOMBSTONE) {
+      if (hash_table->flags & HASH_OWN_KEYS)
+        range->garbage += _HASH_ENTRY_SIZE(build->lens[k]);
+    } else {
+      if (hash_table->flags & HASH_OWN_KEYS)
+        _HASH_KEY_REF(hash_table, i) = build->refs[k];
+      if (hash_table->ctrl)
+        _hash_swiss_set(hash_table, i, key_hash);
+      else
+        _HASH_KEY(hash_table, i) = key_hash;
+
+      unsigned int displacement = _hash_displacement(hash_table, i);
+      range->count += 1;
+      range->probe_total += displacement;
+      range->displaced += displacement != 0;
+      if (displacement + 1 > range->max_probe)
+        range->max_probe = displacement + 1;
+    }
+    _HASH_VALUE(hash_table, i) = build->values[k];
+  }
+  range->deferred = deferred;
+}
+
+static void* _build_task(void* arg) {
+  _hash_build_task_t* task = arg;
+  task->step(task->build, task->t);
+  return NULL;
+}
+
+// Runs a step on every thread, and waits for all of them. If a thread
+// can not be started, its part runs on the calling thread instead.
+static void _build_run(_hash_build_t* build, void (*step)(_hash_build_t* build, unsigned int t)) {
+  pthread_t threads[HASH_BUILD_MAX_THREADS];
+  _hash_build_task_t tasks[HASH_BUILD_MAX_THREADS];
+  int started[HASH_BUILD_MAX_THREADS];
+  for (unsigned int t = 1; t < build->threads; t++) {
+    tasks[t] = (_hash_build_task_t) { build, t, step };
+    started[t] = pthread_create(&threads[t], NULL, _build_task, &tasks[t]) == 0;
+    if (!started[t])
+      step(build, t);
+  }
+  step(build, 0);
+  for (unsigned int t = 1; t < build->threads; t++)
+    if (started[t])
+      pthread_join(threads[t], NULL);
+}
+
+// Picks how many threads to use, from the amount asked for (0 for one
+// per CPU) and the size of the table. Each thread gets at least
+// HASH_BUILD_MIN_SLOTS slots, as a thread per handful of keys costs more
+// than it saves.
+static unsigned int _build_threads(unsigned int threads, unsigned int size) {
+  if (threads == 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? (unsigned int) cpus : 1;
+  }
+  if (threads > HASH_BUILD_MAX_THREADS)
+    threads = HASH_BUILD_MAX_THREADS;
+  if (threads > size / HASH_BUILD_MIN_SLOTS)
+    threads = size / HASH_BUILD_MIN_SLOTS;
+  return threads ? threads : 1;
+}
+
+static int _build_alloc(_hash_build_t* build) {
+  size_t n = build->n ? build->n : 1;
+  size_t threads = build->threads;
+  build->hashes = malloc(n * sizeof(unsigned long));
+  build->lens = malloc(n * sizeof(size_t));
+  build->refs = malloc(n * sizeof(size_t));
+  build->order = malloc(n * sizeof(unsigned int));
+  build->counts = calloc(threads * threads, sizeof(size_t));
+  build->arena_bytes = malloc(threads * sizeof(size_t));
+  build->starts = malloc((threads + 1) * sizeof(size_t));
+  build->ranges = calloc(threads, sizeof(struct HashBuildRange));
+  if (build->hashes == NULL || build->lens == NULL || build->refs == NULL || build->order == NULL
+      || build->counts == NULL || build->arena_bytes == NULL || build->starts == NULL
+      || build->ranges == NULL)
+    return -1;
+  return 0;
+}
+
+static void _build_free(_hash_build_t* build) {
+  free(build->hashes);
+  free(build->lens);
+  free(build->refs);
+  free(build->order);
+  free(build->counts);
+  free(build->arena_bytes);
+  free(build->starts);
+  free(build->ranges);
+}
+
+// Lays out where everything from step 1 goes, and makes the arena.
+static int _build_layout(_hash_build_t* build) {
+  hash_t* hash_table = build->hash_table;
+  unsigned int threads = build->threads;
+
+  // Each chunk's keys go after those of the chunks before it.
+  size_t arena_len = 0;
+  for (unsigned int t = 0; t < threads; t++) {
+    size_t bytes = build->arena_bytes[t];
+    build->arena_bytes[t] = arena_len;
+    arena_len += bytes;
+  }
+  if (hash_table->flags & HASH_OWN_KEYS) {
+    hash_table->arena = malloc(arena_len ? arena_len : 1);
+    if (hash_table->arena == NULL) return -1;
+    hash_table->arena_len = arena_len;
+    hash_table->arena_cap = arena_len;
+  }
+
+  // Ranges one after another in `order`, each holding its keys chunk by
+  // chunk.
+  size_t at = 0;
+  for (unsigned int r = 0; r < threads; r++) {
+    build->starts[r] = at;
+    for (unsigned int t = 0; t < threads; t++) {
+      size_t count = build->counts[(size_t) t * threads + r];
+      build->counts[(size_t) t * threads + r] = at;
+      at += count;
+    }
+  }
+  build->starts[threads] = at;
+  return 0;
+}
+
+// Step 4, putting in the keys left over as a put would, and adding up
+// what the ranges did.
+static void _build_finish(_hash_build_t* build) {
+  hash_t* hash_table = build->hash_table;
+  for (unsigned int r = 0; r < build->threads; r++) {
+    struct HashBuildRange* range = &build->ranges[r];
+    hash_table->count += range->count;
+    hash_table->displaced += range->displaced;
+    hash_table->probe_total += range->probe_total;
+    if (range->max_probe > hash_table->max_probe)
+      hash_table->max_probe = range->max_probe;
+    hash_table->arena_garbage += range->garbage;
+  }
+  // The ranges wrote their slots without the filter, which shares its
+  // blocks across all of them.
+  if (hash_table->filter)
+    _hash_filter_rebuild(hash_table);
+
+  for (unsigned int r = 0; r < build->threads; r++) {
+    for (size_t o = build->starts[r]; o < build->starts[r] + build->ranges[r].deferred; o++) {
+      unsigned int k = build->order[o];
+      // Sized for every key, so there is always room.
+      int i = _hash_probe(hash_table, build->hashes[k], build->keys[k], build->lens[k]);
+      if (_HASH_KEY(hash_table, i) > HASH_TOMBSTONE) {
+        if (hash_table->flags & HASH_OWN_KEYS)
+          hash_table->arena_garbage += _HASH_ENTRY_SIZE(build->lens[k]);
+      } else {
+        if (hash_table->flags & HASH_OWN_KEYS)
+          _HASH_KEY_REF(hash_table, i) = build->refs[k];
+        _hash_occupy(hash_table, i, build->hashes[k]);
+      }
+      _HASH_VALUE(hash_table, i) = build->values[k];
+    }
+  }
+}
+
+// Makes a table with `flags` as by `hash_new_flags`, holding the `n`
+// keys with their values, as if they were put in order. The table gets
+// room for all keys at the default load factor. Uses up to `threads`
+// threads (or one per CPU if 0), fewer for small tables.
+// Returns NULL if Malloc fails, or if there are too many keys.
+hash_t* hash_build(const char* const* keys, void* const* values, size_t n, unsigned int flags,
+                   unsigned int threads) {
+  double slots = (double) n / HASH_DEFAULT_MAX_LOAD + 1.0;
+  if (slots > INT_MAX / 2) return NULL;
+  hash_t* hash_table = hash_new_flags((unsigned int) slots, flags);
+  if (hash_table == NULL) return NULL;
+
+  _hash_build_t build = {
+    .hash_table = hash_table,
+    .keys = keys,
+    .values = values,
+    .n = n,
+    .threads = _build_threads(threads, hash_table->size),
+  };
+  // Ranges split the table evenly, in whole groups for HASH_SWISS.
+  unsigned int unit = hash_table->ctrl ? HASH_SWISS_GROUP : 1;
+  unsigned int units = hash_table->size / unit;
+  build.range_slots = (units + build.threads - 1) / build.threads * unit;
+
+  if (_build_alloc(&build) == -1) goto fail;
+  _build_run(&build, _build_hash_step);
+  if (_build_layout(&build) == -1) goto fail;
+  _build_run(&build, _build_scatter_step);
+  _build_run(&build, _build_insert_step);
+  _build_finish(&build);
+
+  _build_free(&build);
+  return hash_table;
+
+  fail:
+  _build_free(&build);
+  hash_free(hash_table);
+  return NULL;
+}
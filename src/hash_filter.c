@@ -0,0 +1,114 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+#include "hash_private.h"
+
+// The membership filter of HASH_FILTER tables: a split block Bloom
+// filter, as used by Apache Parquet. The filter is an array of blocks of
+// one cache line each, split into 8 words. A key picks one block, and
+// sets one bit in each of its words, so checking a key reads a single
+// cache line, and a key not in the table is caught unless all 8 of its
+// bits happen to be set.
+//
+// With HASH_FILTER_BITS bits per slot, a table at the default load
+// factor has about 21 bits per key, and lets through well under one
+// miss in a hundred.
+//
+// Bits are worked out from the hash stored in `keys`, so the filter can
+// be rebuilt from the table without hashing any key again. Bloom filters
+// can not forget keys, so removed keys stay in the filter until enough
+// of them pile up to rebuild it.
+//
+// Source: https://github.com/apache/parquet-format/blob/master/BloomFilter.md
+
+// Odd constants, spreading a hash over the bits of each word.
+static const uint32_t _FILTER_SALT[_HASH_FILTER_WORDS] = {
+  0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+  0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+// Spreads the bits of the hash (the finalizer of splitmix64), as `djb2`
+// leaves its upper bits mostly alike.
+static uint64_t _filter_mix(unsigned long key_hash) {
+  uint64_t x = key_hash;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+static unsigned long long* _filter_block(const hash_t* hash_table, uint64_t mixed) {
+  size_t block = (size_t) (mixed >> 32) & hash_table->filter_mask;
+  return hash_table->filter + block * _HASH_FILTER_WORDS;
+}
+
+static unsigned long long _filter_bit(uint64_t mixed, unsigned int word) {
+  // The top 6 bits of the product pick one of the 64 bits of the word.
+  return 1ull << (((uint32_t) mixed * _FILTER_SALT[word]) >> 26);
+}
+
+// Amount of bytes of a filter for `size` slots: a power of two amount
+// of blocks, so one can be picked with a mask.
+size_t _hash_filter_bytes(unsigned int size) {
+  size_t bits = (size_t) size * HASH_FILTER_BITS;
+  size_t blocks = 1;
+  while (blocks * _HASH_FILTER_WORDS * 64 < bits)
+    blocks *= 2;
+  return blocks * _HASH_FILTER_BLOCK;
+}
+
+// Makes an empty filter for `size` slots. Returns NULL if Malloc fails.
+unsigned long long* _hash_filter_alloc(unsigned int size, unsigned int* mask) {
+  size_t bytes = _hash_filter_bytes(size);
+  unsigned long long* filter = aligned_alloc(_HASH_FILTER_BLOCK, bytes);
+  if (filter == NULL) return NULL;
+  memset(filter, 0, bytes);
+  *mask = (unsigned int) (bytes / _HASH_FILTER_BLOCK - 1);
+  return filter;
+}
+
+void _hash_filter_add(hash_t* hash_table, unsigned long key_hash) {
+  uint64_t mixed = _filter_mix(key_hash);
+  unsigned long long* block = _filter_block(hash_table, mixed);
+  for (unsigned int w = 0; w < _HASH_FILTER_WORDS; w++)
+    block[w] |= _filter_bit(mixed, w);
+}
+
+// Zero if the key is certainly not in the table.
+int _hash_filter_may_have(const hash_t* hash_table, unsigned long key_hash) {
+  uint64_t mixed = _filter_mix(key_hash);
+  const unsigned long long* block = _filter_block(hash_table, mixed);
+  unsigned long long missing = 0;
+  for (unsigned int w = 0; w < _HASH_FILTER_WORDS; w++)
+    missing |= ~block[w] & _filter_bit(mixed, w);
+  return missing == 0;
+}
+
+void _hash_filter_prefetch(const hash_t* hash_table, unsigned long key_hash) {
+  _HASH_PREFETCH(_filter_block(hash_table, _filter_mix(key_hash)));
+}
+
+// Clears the filter, and adds every key still in the table.
+void _hash_filter_rebuild(hash_t* hash_table) {
+  memset(hash_table->filter, 0, _hash_filter_bytes(hash_table->size));
+  for (unsigned int i = 0; i < hash_table->size; i++)
+    if (_HASH_KEY(hash_table, i) > HASH_TOMBSTONE)
+      _hash_filter_add(hash_table, _HASH_KEY(hash_table, i));
+  hash_table->filter_stale = 0;
+}
+
+// Notes that a key was removed, which leaves its bits behind. Once an
+// eighth of the slots worth of keys were removed, the filter is rebuilt,
+// which takes a pass over the table, so it adds up to a few slots a
+// remove.
+void _hash_filter_removed(hash_t* hash_table) {
+  hash_table->filter_stale += 1;
+  if (hash_table->filter_stale > hash_table->size / 8)
+    _hash_filter_rebuild(hash_table);
+}
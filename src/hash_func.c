@@ -0,0 +1,62 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__linux__)
+#include <sys/random.h>
+#endif
+#include "hash.h"
+
+// Reads 8 bytes from the system's random source, or returns 0 if there
+// is none.
+static uint64_t _hash_entropy(void) {
+  uint64_t entropy = 0;
+#if defined(__linux__)
+  if (getrandom(&entropy, sizeof(entropy), 0) == (ssize_t) sizeof(entropy))
+    return entropy;
+#endif
+  FILE* random = fopen("/dev/urandom", "rb");
+  if (random) {
+    if (fread(&entropy, sizeof(entropy), 1, random) != 1)
+      entropy = 0;
+    fclose(random);
+  }
+  return entropy;
+}
+
+// Returns a seed which is hard to guess from outside the process, and
+// differs on every call. The system's random source is only read for
+// the first seed, into a key for the whole process. Later seeds mix
+// that key with a counter, so making a table costs no system call. Safe
+// to call from several threads at once.
+unsigned long hash_random_seed(void) {
+  static _Atomic uint64_t key = 0;
+  static _Atomic uint64_t counter = 0;
+
+  uint64_t k = atomic_load_explicit(&key, memory_order_relaxed);
+  if (k == 0) {
+    // Mixed with the time and a few addresses (which ASLR shuffles), in
+    // case there is no random source. Threads racing here all agree on
+    // whichever key is stored first.
+    uint64_t local;
+    uint64_t noise[4] = {
+      (uint64_t) time(NULL), (uint64_t) clock(),
+      (uint64_t) (uintptr_t) &local, (uint64_t) (uintptr_t) &hash_random_seed,
+    };
+    uint64_t fresh = hash_wy((const char*) noise, sizeof(noise), (unsigned long) _hash_entropy());
+    fresh |= 1; // 0 means not made yet.
+    if (atomic_compare_exchange_strong_explicit(&key, &k, fresh, memory_order_relaxed, memory_order_relaxed))
+      k = fresh;
+  }
+
+  uint64_t n = atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed);
+  // Hashing the counter with the key as seed, which only who knows the
+  // key can predict.
+  return hash_wy((const char*) &n, sizeof(n), (unsigned long) k);
+}
@@ -0,0 +1,68 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#ifndef SW2ALG_HASH_PRIVATE_H_
+#define SW2ALG_HASH_PRIVATE_H_
+
+// Internals shared between the source files of the hash library.
+
+#include <stddef.h>
+#include "hash.h"
+
+// Control bytes of HASH_SWISS tables. Full slots hold 0-127.
+#define _HASH_CTRL_EMPTY ((signed char) -128)
+#define _HASH_CTRL_DELETED ((signed char) -2)
+
+// A slot of a HASH_INTERLEAVED table. `key_ref` is left off the end of
+// each slot unless the table owns its keys.
+typedef struct HashSlot {
+  unsigned long key;
+  void* value;
+  size_t key_ref;
+} _hash_slot_t;
+
+// The `keys`, `values` and `key_refs` of slot `i`, whichever the layout.
+#define _HASH_KEY(t, i) (*(unsigned long*) ((char*) (t)->keys + (size_t) (i) * (t)->key_stride))
+#define _HASH_VALUE(t, i) (*(void**) ((char*) (t)->values + (size_t) (i) * (t)->value_stride))
+#define _HASH_KEY_REF(t, i) (*(size_t*) ((char*) (t)->key_refs + (size_t) (i) * (t)->ref_stride))
+
+// Owned keys are stored in the arena as `[unsigned int length][bytes][\0]`.
+#define _HASH_ENTRY_SIZE(len) (sizeof(unsigned int) + (len) + 1)
+
+#if defined(__GNUC__)
+#define _HASH_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define _HASH_PREFETCH(addr) ((void) (addr))
+#endif
+
+unsigned long _hash_key(const hash_t* hash_table, const char* key, size_t len);
+int _hash_probe(const hash_t* hash_table, unsigned long key_hash, const char* key, size_t len);
+void _hash_occupy(hash_t* hash_table, unsigned int i, unsigned long key_hash);
+unsigned int _hash_displacement(const hash_t* hash_table, unsigned int i);
+int _hash_key_equal(const hash_t* hash_table, unsigned int i, const char* key, size_t len);
+int _hash_settle(hash_t* hash_table);
+void _hash_unmap(hash_t* hash_table);
+
+// Words of a Bloom filter block, and its bytes, which fill a cache line.
+#define _HASH_FILTER_WORDS 8
+#define _HASH_FILTER_BLOCK (_HASH_FILTER_WORDS * sizeof(unsigned long long))
+
+size_t _hash_filter_bytes(unsigned int size);
+unsigned long long* _hash_filter_alloc(unsigned int size, unsigned int* mask);
+void _hash_filter_add(hash_t* hash_table, unsigned long key_hash);
+int _hash_filter_may_have(const hash_t* hash_table, unsigned long key_hash);
+void _hash_filter_prefetch(const hash_t* hash_table, unsigned long key_hash);
+void _hash_filter_rebuild(hash_t* hash_table);
+void _hash_filter_removed(hash_t* hash_table);
+
+unsigned int _hash_swiss_capacity(unsigned int size);
+int _hash_swiss_probe(const hash_t* hash_table, unsigned long key_hash, const char* key, size_t len);
+void _hash_swiss_set(hash_t* hash_table, unsigned int i, unsigned long key_hash);
+void _hash_swiss_erase(hash_t* hash_table, unsigned int i);
+unsigned int _hash_swiss_home(const hash_t* hash_table, unsigned long key_hash);
+unsigned int _hash_swiss_displacement(const hash_t* hash_table, unsigned int i);
+
+#endif //SW2ALG_HASH_PRIVATE_H_
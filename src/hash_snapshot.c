@@ -0,0 +1,409 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash.h"
+#include "hash_private.h"
+
+// Snapshots of a table on disk, which `hash_load` maps into memory as
+// they are, so loading takes the same time whatever the size of the
+// table, and processes mapping the same snapshot share its pages.
+//
+// A snapshot is a header followed by sections, each starting on a
+// multiple of _SNAPSHOT_ALIGN bytes:
+//
+//   header | values | slots (keys, values and key refs) | ctrl | filter | arena
+//
+// The slot arrays are written just as the table holds them in memory,
+// be they interleaved or not, so a probe on the mapping works the same
+// as on the table. Only the values differ. With an encoder, the bytes of
+// each value go into the values section, and the slot holds the offset
+// to them. Otherwise the values are written as they are, which only
+// makes sense for values which are not pointers.
+//
+// The format is that of the machine which wrote it (its byte order and
+// the size of its words), which the header records so other machines
+// refuse it. Snapshots are trusted: only their header is checked.
+
+#define _SNAPSHOT_MAGIC "SW2HASH"
+#define _SNAPSHOT_ALIGN 64u
+// Encoded values are aligned to hold any type.
+#define _SNAPSHOT_VALUE_ALIGN 16u
+#define _SNAPSHOT_BYTE_ORDER 0x01020304u
+
+enum {
+  _SNAPSHOT_FUNC_DJB2 = 1,
+  _SNAPSHOT_FUNC_WY = 2,
+};
+
+typedef struct HashSnapshotSection {
+  uint64_t offset;
+  uint64_t len;
+} _snapshot_section_t;
+
+typedef struct HashSnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint8_t long_size;
+  uint8_t size_t_size;
+  uint8_t pointer_size;
+  uint8_t encoded; // Non zero if the values are offsets into `values`.
+  uint32_t hash_func;
+  uint64_t seed;
+  uint32_t flags;
+  uint32_t size;
+  uint32_t count;
+  uint32_t tombstones;
+  uint32_t displaced;
+  uint32_t max_probe;
+  uint64_t probe_total;
+  double max_load;
+  uint32_t key_stride;
+  uint32_t value_stride;
+  uint32_t ref_stride;
+  uint32_t reserved;
+  _snapshot_section_t keys;
+  _snapshot_section_t slot_values;
+  _snapshot_section_t key_refs;
+  _snapshot_section_t ctrl;
+  _snapshot_section_t filter;
+  _snapshot_section_t arena;
+  _snapshot_section_t values;
+  uint64_t file_len;
+} _snapshot_header_t;
+
+static uint64_t _snapshot_align(uint64_t offset, uint64_t align) {
+  return (offset + align - 1) / align * align;
+}
+
+// Pads the file up to `offset`, which is never behind where it is.
+static int _snapshot_pad(FILE* file, uint64_t* at, uint64_t offset) {
+  static const char zeros[_SNAPSHOT_ALIGN] = { 0 };
+  while (*at < offset) {
+    size_t n = offset - *at < sizeof(zeros) ? (size_t) (offset - *at) : sizeof(zeros);
+    if (fwrite(zeros, 1, n, file) != n) return -1;
+    *at += n;
+  }
+  return 0;
+}
+
+// Writes a section at the next aligned offset, recording where it went.
+static int _snapshot_section(FILE* file, uint64_t* at, const void* data, size_t len, _snapshot_section_t* section) {
+  section->offset = _snapshot_align(*at, _SNAPSHOT_ALIGN);
+  section->len = len;
+  if (_snapshot_pad(file, at, section->offset) == -1) return -1;
+  if (len && fwrite(data, 1, len, file) != len) return -1;
+  *at += len;
+  return 0;
+}
+
+// Copies the array of `array_len` bytes holding the values (which are
+// either all of `values`, or the interleaved slots), with the value of
+// every live slot replaced by the offset of its encoded bytes. Writes
+// the encoded bytes out as the values section.
+static char* _snapshot_encode(const hash_t* hash_table, const void* array, size_t array_len, FILE* file,
+                              uint64_t* at, _snapshot_section_t* section, hash_encode_t encode, void* ctx) {
+  char* slots = malloc(array_len);
+  if (slots == NULL) return NULL;
+  memcpy(slots, array, array_len);
+  // The copy is indexed like `values`, by pointing a table at it.
+  hash_t copy = *hash_table;
+  copy.values = (void**) (slots + ((const char*) hash_table->values - (const char*) array));
+
+  section->offset = _snapshot_align(*at, _SNAPSHOT_ALIGN);
+  if (_snapshot_pad(file, at, section->offset) == -1) goto fail;
+  uint64_t len = 0;
+  for (unsigned int i = 0; i < hash_table->size; i++) {
+    if (_HASH_KEY(hash_table, i) <= HASH_TOMBSTONE) continue;
+    size_t value_len = 0;
+    const void* bytes = encode(_HASH_VALUE(hash_table, i), &value_len, ctx);
+    if (bytes == NULL) goto fail;
+
+    len = _snapshot_align(len, _SNAPSHOT_VALUE_ALIGN);
+    if (_snapshot_pad(file, at, section->offset + len) == -1) goto fail;
+    if (value_len && fwrite(bytes, 1, value_len, file) != value_len) goto fail;
+    _HASH_VALUE(&copy, i) = (void*) (uintptr_t) len;
+    len += value_len;
+    *at += value_len;
+  }
+  section->len = len;
+  return slots;
+
+  fail:
+  free(slots);
+  return NULL;
+}
+
+// Opens a new file next to `path` to write a snapshot into, storing its
+// name in `tmp_path`, which the caller frees. Returns NULL on failure.
+static FILE* _snapshot_create_tmp(const char* path, char** tmp_path) {
+  static _Atomic unsigned int counter = 0;
+  size_t len = strlen(path) + 48;
+  char* name = malloc(len);
+  if (name == NULL) return NULL;
+  unsigned int n = atomic_fetch_add_explicit(&counter, 1, memory_order_relaxed);
+  snprintf(name, len, "%s.%ld.%u.tmp", path, (long) getpid(), n);
+
+  // Made with the permissions `fopen` would give it, less the umask.
+  int fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0666);
+  FILE* file = fd == -1 ? NULL : fdopen(fd, "wb");
+  if (file == NULL) {
+    if (fd != -1) {
+      close(fd);
+      unlink(name);
+    }
+    free(name);
+    return NULL;
+  }
+  *tmp_path = name;
+  return file;
+}
+
+// Writes the table out to `path`, replacing whatever was there. Values
+// are written as the bytes `encode` returns for them, or as they are if
+// `encode` is NULL. Finishes any resize of a growable table first.
+//
+// The snapshot is written to a file next to `path`, flushed to disk, and
+// then renamed over `path` in one step. Processes which have the old
+// snapshot mapped keep reading it, as its pages live on until unmapped,
+// and a failed save leaves it as it was.
+// Returns -1 if the table uses a hash function other than `hash_djb2`
+// or `hash_wy`, if writing fails, or if Malloc fails.
+int hash_save(hash_t* hash_table, const char* path, hash_encode_t encode, void* ctx) {
+  _snapshot_header_t header;
+  memset(&header, 0, sizeof(header));
+  if (hash_table->hash_func == hash_djb2)
+    header.hash_func = _SNAPSHOT_FUNC_DJB2;
+  else if (hash_table->hash_func == hash_wy)
+    header.hash_func = _SNAPSHOT_FUNC_WY;
+  else
+    return -1;
+  if (hash_table->mapping == NULL && _hash_settle(hash_table) == -1) return -1;
+  // A loaded snapshot has its values encoded already, and can not be
+  // encoded again.
+  if (hash_table->mapped_values) return -1;
+
+  memcpy(header.magic, _SNAPSHOT_MAGIC, sizeof(_SNAPSHOT_MAGIC));
+  header.version = HASH_SNAPSHOT_VERSION;
+  header.byte_order = _SNAPSHOT_BYTE_ORDER;
+  header.long_size = sizeof(unsigned long);
+  header.size_t_size = sizeof(size_t);
+  header.pointer_size = sizeof(void*);
+  header.encoded = encode != NULL;
+  header.seed = hash_table->seed;
+  header.flags = hash_table->flags;
+  header.size = hash_table->size;
+  header.count = hash_table->count;
+  header.tombstones = hash_table->tombstones;
+  header.displaced = hash_table->displaced;
+  header.max_probe = hash_table->max_probe;
+  header.probe_total = hash_table->probe_total;
+  header.max_load = hash_table->max_load;
+  header.key_stride = hash_table->key_stride;
+  header.value_stride = hash_table->value_stride;
+  header.ref_stride = hash_table->ref_stride;
+
+  char* tmp_path = NULL;
+  FILE* file = _snapshot_create_tmp(path, &tmp_path);
+  if (file == NULL) return -1;
+  char* slots = NULL;
+  uint64_t at = 0;
+  // The header goes in last, once every section is known.
+  if (_snapshot_pad(file, &at, sizeof(header)) == -1) goto fail;
+
+  size_t size = hash_table->size;
+  int interleaved = (hash_table->flags & HASH_INTERLEAVED) != 0;
+  int own_keys = (hash_table->flags & HASH_OWN_KEYS) != 0;
+  if (interleaved) {
+    // One array of slots, holding all three, starting with the first key.
+    size_t slots_len = size * hash_table->key_stride;
+    const void* data = hash_table->keys;
+    if (encode) {
+      slots = _snapshot_encode(hash_table, data, slots_len, file, &at, &header.values, encode, ctx);
+      if (slots == NULL) goto fail;
+      data = slots;
+    }
+    if (_snapshot_section(file, &at, data, slots_len, &header.keys) == -1) goto fail;
+    uint64_t lead = (uint64_t) ((char*) hash_table->values - (char*) hash_table->keys);
+    header.slot_values = (_snapshot_section_t) { header.keys.offset + lead, slots_len - lead };
+    if (own_keys) {
+      lead = (uint64_t) ((char*) hash_table->key_refs - (char*) hash_table->keys);
+      header.key_refs = (_snapshot_section_t) { header.keys.offset + lead, slots_len - lead };
+    }
+  } else {
+    const void* values = hash_table->values;
+    if (encode) {
+      slots = _snapshot_encode(hash_table, values, size * sizeof(void*), file, &at, &header.values, encode, ctx);
+      if (slots == NULL) goto fail;
+      values = slots;
+    }
+    if (_snapshot_section(file, &at, hash_table->keys, size * sizeof(unsigned long), &header.keys) == -1
+        || _snapshot_section(file, &at, values, size * sizeof(void*), &header.slot_values) == -1)
+      goto fail;
+    if (own_keys
+        && _snapshot_section(file, &at, hash_table->key_refs, size * sizeof(size_t), &header.key_refs) == -1)
+      goto fail;
+  }
+  if (hash_table->ctrl
+      && _snapshot_section(file, &at, hash_table->ctrl, size, &header.ctrl) == -1)
+    goto fail;
+  if (hash_table->filter
+      && _snapshot_section(file, &at, hash_table->filter, _hash_filter_bytes(hash_table->size), &header.filter) == -1)
+    goto fail;
+  if (own_keys
+      && _snapshot_section(file, &at, hash_table->arena, hash_table->arena_len, &header.arena) == -1)
+    goto fail;
+  header.file_len = at;
+
+  if (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1
+      || fflush(file) != 0 || fsync(fileno(file)) == -1)
+    goto fail;
+  free(slots);
+  slots = NULL;
+  int closed = fclose(file);
+  file = NULL;
+  if (closed != 0 || rename(tmp_path, path) == -1) goto fail;
+  free(tmp_path);
+  return 0;
+
+  fail:
+  free(slots);
+  if (file)
+    fclose(file);
+  unlink(tmp_path);
+  free(tmp_path);
+  return -1;
+}
+
+// Checks that a section lies within the file, at an aligned offset.
+static int _snapshot_valid(const _snapshot_section_t* section, uint64_t file_len, uint64_t align) {
+  return section->offset % align == 0 && section->offset <= file_len
+         && section->len <= file_len - section->offset;
+}
+
+static int _snapshot_check(const _snapshot_header_t* header, uint64_t file_len) {
+  if (memcmp(header->magic, _SNAPSHOT_MAGIC, sizeof(_SNAPSHOT_MAGIC)) != 0
+      || header->version != HASH_SNAPSHOT_VERSION
+      || header->byte_order != _SNAPSHOT_BYTE_ORDER
+      || header->long_size != sizeof(unsigned long)
+      || header->size_t_size != sizeof(size_t)
+      || header->pointer_size != sizeof(void*)
+      || header->file_len != file_len
+      || header->size == 0
+      || (header->hash_func != _SNAPSHOT_FUNC_DJB2 && header->hash_func != _SNAPSHOT_FUNC_WY))
+    return -1;
+
+  uint64_t size = header->size;
+  int own_keys = (header->flags & HASH_OWN_KEYS) != 0;
+  if (header->flags & HASH_INTERLEAVED) {
+    uint64_t stride = own_keys ? sizeof(_hash_slot_t) : offsetof(_hash_slot_t, key_ref);
+    if (header->key_stride != stride || header->value_stride != stride || header->ref_stride != stride
+        || header->keys.len != size * stride)
+      return -1;
+  } else if (header->key_stride != sizeof(unsigned long) || header->value_stride != sizeof(void*)
+             || header->ref_stride != sizeof(size_t)
+             || header->keys.len != size * sizeof(unsigned long)
+             || header->slot_values.len != size * sizeof(void*)
+             || (own_keys && header->key_refs.len != size * sizeof(size_t))) {
+    return -1;
+  }
+  if (header->flags & HASH_SWISS && header->ctrl.len != size) return -1;
+  if (header->flags & HASH_FILTER && header->filter.len != _hash_filter_bytes(header->size)) return -1;
+
+  const _snapshot_section_t* sections[] = {
+    &header->keys, &header->ctrl, &header->filter, &header->arena, &header->values,
+  };
+  for (size_t s = 0; s < sizeof(sections) / sizeof(sections[0]); s++)
+    if (!_snapshot_valid(sections[s], file_len, _SNAPSHOT_ALIGN)) return -1;
+  if (!_snapshot_valid(&header->slot_values, file_len, sizeof(void*))
+      || !_snapshot_valid(&header->key_refs, file_len, sizeof(size_t)))
+    return -1;
+  return 0;
+}
+
+// Maps a snapshot written by `hash_save` into memory, read-only, and
+// returns a table reading straight from it. Gets and lookups work as on
+// the saved table, where the values are pointers to their encoded bytes
+// if it was saved with an encoder. Puts and removes are refused. The
+// mapping goes away with `hash_free`.
+// Returns NULL if the file can not be mapped, or is not a snapshot this
+// machine can read.
+hash_t* hash_load(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) return NULL;
+  struct stat st;
+  if (fstat(fd, &st) == -1 || (uint64_t) st.st_size < sizeof(_snapshot_header_t)) {
+    close(fd);
+    return NULL;
+  }
+  size_t mapping_len = (size_t) st.st_size;
+  char* mapping = mmap(NULL, mapping_len, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid once the file is closed.
+  close(fd);
+  if (mapping == MAP_FAILED) return NULL;
+
+  const _snapshot_header_t* header = (const _snapshot_header_t*) mapping;
+  hash_t* hash_table = NULL;
+  if (_snapshot_check(header, mapping_len) == -1) goto fail;
+  hash_table = calloc(1, sizeof(hash_t));
+  if (hash_table == NULL) goto fail;
+
+  hash_table->mapping = mapping;
+  hash_table->mapping_len = mapping_len;
+  hash_table->hash_func = header->hash_func == _SNAPSHOT_FUNC_WY ? hash_wy : hash_djb2;
+  hash_table->seed = (unsigned long) header->seed;
+  // Never resized, as it can not change.
+  hash_table->flags = header->flags & ~HASH_GROWABLE;
+  hash_table->size = header->size;
+  hash_table->count = header->count;
+  hash_table->tombstones = header->tombstones;
+  hash_table->displaced = header->displaced;
+  hash_table->max_probe = header->max_probe;
+  hash_table->probe_total = (unsigned long) header->probe_total;
+  hash_table->max_load = header->max_load;
+  hash_table->key_stride = header->key_stride;
+  hash_table->value_stride = header->value_stride;
+  hash_table->ref_stride = header->ref_stride;
+
+  // Casting away const, nothing writes through them, see `hash_put`.
+  hash_table->keys = (unsigned long*) (mapping + header->keys.offset);
+  hash_table->values = (void**) (mapping + header->slot_values.offset);
+  if (hash_table->flags & HASH_OWN_KEYS) {
+    hash_table->key_refs = (size_t*) (mapping + header->key_refs.offset);
+    hash_table->arena = mapping + header->arena.offset;
+    hash_table->arena_len = header->arena.len;
+    hash_table->arena_cap = header->arena.len;
+  }
+  if (hash_table->flags & HASH_SWISS)
+    hash_table->ctrl = (signed char*) (mapping + header->ctrl.offset);
+  if (hash_table->flags & HASH_FILTER) {
+    // Misses are likely the most common lookup on a table which never
+    // changes, so the filter is kept.
+    hash_table->filter = (unsigned long long*) (mapping + header->filter.offset);
+    hash_table->filter_mask = (unsigned int) (header->filter.len / _HASH_FILTER_BLOCK - 1);
+  }
+  if (header->encoded)
+    hash_table->mapped_values = mapping + header->values.offset;
+  return hash_table;
+
+  fail:
+  free(hash_table);
+  munmap(mapping, mapping_len);
+  return NULL;
+}
+
+void _hash_unmap(hash_t* hash_table) {
+  munmap(hash_table->mapping, hash_table->mapping_len);
+}
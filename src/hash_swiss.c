@@ -0,0 +1,181 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <limits.h>
+#include <stdint.h>
+#include "hash.h"
+#include "hash_private.h"
+
+#if defined(__SSE2__) && !defined(HASH_NO_SIMD)
+#include <emmintrin.h>
+#endif
+
+// The probing engine of HASH_SWISS tables, modelled after Google's
+// "Swiss tables" as presented by Matt Kulukundis at CppCon 2017.
+//
+// Slots are split into groups of HASH_SWISS_GROUP. Each slot has one
+// control byte, which is either empty, deleted, or holds the lowest 7
+// bits of the slot's hash (`h2`). A probe compares a whole group of
+// control bytes to `h2` at once, and only looks at `keys` for the few
+// slots that match. The remaining bits (`h1`) pick the first group.
+//
+// Source: https://abseil.io/about/design/swisstables
+
+// Bitmask with one bit set for every matching slot in a group.
+typedef unsigned int _group_mask_t;
+
+// Spread the hash out over all bits, as `djb2` keeps most of its
+// entropy in the low bits which would otherwise all go to `h2`.
+static uint64_t _swiss_mix(unsigned long key_hash) {
+  uint64_t mixed = (uint64_t) key_hash * 0x9E3779B97F4A7C15ull;
+  return mixed ^ (mixed >> 32);
+}
+
+static signed char _swiss_h2(uint64_t mixed) {
+  return (signed char) (mixed & 0x7f);
+}
+
+static unsigned int _swiss_ctz(_group_mask_t mask) {
+#if defined(__GNUC__)
+  return __builtin_ctz(mask);
+#else
+  unsigned int n = 0;
+  while (!(mask & 1u)) {
+    mask >>= 1;
+    n += 1;
+  }
+  return n;
+#endif
+}
+
+#if defined(__SSE2__) && !defined(HASH_NO_SIMD)
+
+static _group_mask_t _group_match(const signed char* group, signed char h2) {
+  __m128i ctrl = _mm_loadu_si128((const __m128i*) group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+}
+
+static _group_mask_t _group_match_empty(const signed char* group) {
+  return _group_match(group, _HASH_CTRL_EMPTY);
+}
+
+// Empty and deleted are the only control bytes with the high bit set.
+static _group_mask_t _group_match_free(const signed char* group) {
+  __m128i ctrl = _mm_loadu_si128((const __m128i*) group);
+  return _mm_movemask_epi8(ctrl);
+}
+
+#else
+
+static _group_mask_t _group_match(const signed char* group, signed char h2) {
+  _group_mask_t mask = 0;
+  for (unsigned int i = 0; i < HASH_SWISS_GROUP; i++)
+    if (group[i] == h2)
+      mask |= 1u << i;
+  return mask;
+}
+
+static _group_mask_t _group_match_empty(const signed char* group) {
+  return _group_match(group, _HASH_CTRL_EMPTY);
+}
+
+static _group_mask_t _group_match_free(const signed char* group) {
+  _group_mask_t mask = 0;
+  for (unsigned int i = 0; i < HASH_SWISS_GROUP; i++)
+    if (group[i] < 0)
+      mask |= 1u << i;
+  return mask;
+}
+
+#endif
+
+// Capacity is a power of two, at least one group, so groups can be
+// picked with a mask instead of a division.
+unsigned int _hash_swiss_capacity(unsigned int size) {
+  unsigned int capacity = HASH_SWISS_GROUP;
+  while (capacity < size && capacity <= INT_MAX / 2)
+    capacity *= 2;
+  return capacity;
+}
+
+// Groups are probed quadratically (by triangular numbers), which visits
+// every group exactly once when the amount of groups is a power of two.
+int _hash_swiss_probe(const hash_t* hash_table, unsigned long key_hash, const char* key, size_t len) {
+  uint64_t mixed = _swiss_mix(key_hash);
+  signed char h2 = _swiss_h2(mixed);
+  unsigned int group_mask = hash_table->size / HASH_SWISS_GROUP - 1;
+  unsigned int group = (unsigned int) (mixed >> 7) & group_mask;
+  int insert_at = -1;
+
+  for (unsigned int step = 0; step <= group_mask; step++) {
+    unsigned int base = group * HASH_SWISS_GROUP;
+    const signed char* ctrl = hash_table->ctrl + base;
+
+    _group_mask_t match = _group_match(ctrl, h2);
+    while (match) {
+      unsigned int i = base + _swiss_ctz(match);
+      if (_HASH_KEY(hash_table, i) == key_hash && _hash_key_equal(hash_table, i, key, len))
+        return i;
+      match &= match - 1;
+    }
+
+    // Remember the first free slot, in case the key does not exist.
+    if (insert_at == -1) {
+      _group_mask_t free_slots = _group_match_free(ctrl);
+      if (free_slots)
+        insert_at = base + _swiss_ctz(free_slots);
+    }
+    // A key is never placed past a group which still has empty slots.
+    if (_group_match_empty(ctrl))
+      return insert_at;
+
+    group = (group + step + 1) & group_mask;
+  }
+  return insert_at;
+}
+
+void _hash_swiss_set(hash_t* hash_table, unsigned int i, unsigned long key_hash) {
+  if (hash_table->ctrl[i] == _HASH_CTRL_DELETED)
+    hash_table->tombstones -= 1;
+  hash_table->ctrl[i] = _swiss_h2(_swiss_mix(key_hash));
+  _HASH_KEY(hash_table, i) = key_hash;
+}
+
+// If the slot's group still has an empty slot, no probe ever continued
+// past it, so the slot can go straight back to empty. Otherwise it has
+// to become a tombstone to keep later groups reachable.
+void _hash_swiss_erase(hash_t* hash_table, unsigned int i) {
+  unsigned int base = i - i % HASH_SWISS_GROUP;
+  if (_group_match_empty(hash_table->ctrl + base)) {
+    hash_table->ctrl[i] = _HASH_CTRL_EMPTY;
+    _HASH_KEY(hash_table, i) = HASH_EMPTY;
+  } else {
+    hash_table->ctrl[i] = _HASH_CTRL_DELETED;
+    _HASH_KEY(hash_table, i) = HASH_TOMBSTONE;
+    hash_table->tombstones += 1;
+  }
+}
+
+// First slot of the group a key's probe starts at.
+unsigned int _hash_swiss_home(const hash_t* hash_table, unsigned long key_hash) {
+  unsigned int group_mask = hash_table->size / HASH_SWISS_GROUP - 1;
+  return ((unsigned int) (_swiss_mix(key_hash) >> 7) & group_mask) * HASH_SWISS_GROUP;
+}
+
+// Amount of groups probed before reaching the group of slot `i`.
+unsigned int _hash_swiss_displacement(const hash_t* hash_table, unsigned int i) {
+  uint64_t mixed = _swiss_mix(_HASH_KEY(hash_table, i));
+  unsigned int group_mask = hash_table->size / HASH_SWISS_GROUP - 1;
+  unsigned int group = (unsigned int) (mixed >> 7) & group_mask;
+  unsigned int target = i / HASH_SWISS_GROUP;
+
+  unsigned int step = 0;
+  while (group != target && step < group_mask) {
+    step += 1;
+    group = (group + step) & group_mask;
+  }
+  return step;
+}
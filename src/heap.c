@@ -0,0 +1,271 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "item.h"
+#include "heap.h"
+
+// A priority queue, as a d-ary heap kept in one array. Pushing, popping
+// the smallest item and changing an item are O(log n), and peeking at
+// the smallest item is O(1).
+//
+// Each item has HEAP_ARITY children instead of two, which makes the
+// tree half as deep. Sifting up compares once a level, so it gets
+// cheaper, and sifting down compares more often a level, but all
+// children of an item lie next to each other, in one or two cache
+// lines.
+//
+// Items move around the array as the heap changes, so each push gives
+// out a handle, which keeps finding its item until it is popped or
+// removed. A handle is a slot in `positions`, which is given out again
+// once its item leaves the heap, and the generation of that slot, which
+// counts how often it was. A handle kept after its item left thus never
+// finds the item of a later push.
+//
+// Source: Donald B. Johnson, "Priority queues with update and finding
+// minimum spanning trees", 1975.
+
+// Set on the `positions` of slots not in use. _HEAP_NO_SLOT has it set
+// as well, and ends the list of free slots.
+#define _HEAP_FREE 0x80000000u
+#define _HEAP_NO_SLOT 0xFFFFFFFFu
+
+static heap_handle_t _heap_handle(const heap_t* heap, unsigned int slot) {
+  return (heap_handle_t) heap->generations[slot] << 32 | slot;
+}
+
+static int _heap_parent(unsigned int i) {
+  return (int) ((i - 1) / HEAP_ARITY);
+}
+
+// Places an item and its slot at position `i`.
+static void _heap_place(heap_t* heap, unsigned int i, item_t item, unsigned int slot) {
+  heap->items[i] = item;
+  heap->slots[i] = slot;
+  heap->positions[slot] = i;
+}
+
+// Moves the item at position `i` towards the top, as far as it goes.
+// The items it passes each move down one level into the hole it leaves.
+static void _heap_sift_up(heap_t* heap, unsigned int i) {
+  item_t item = heap->items[i];
+  unsigned int slot = heap->slots[i];
+  while (i > 0) {
+    unsigned int parent = (unsigned int) _heap_parent(i);
+    if (heap->cmp(item, heap->items[parent]) >= 0) break;
+    _heap_place(heap, i, heap->items[parent], heap->slots[parent]);
+    i = parent;
+  }
+  _heap_place(heap, i, item, slot);
+}
+
+// Moves the item at position `i` towards the bottom, as far as it goes.
+static void _heap_sift_down(heap_t* heap, unsigned int i) {
+  item_t item = heap->items[i];
+  unsigned int slot = heap->slots[i];
+  for (;;) {
+    size_t first = (size_t) i * HEAP_ARITY + 1;
+    if (first >= heap->length) break;
+    size_t last = first + HEAP_ARITY < heap->length ? first + HEAP_ARITY : heap->length;
+    size_t least = first;
+    for (size_t child = first + 1; child < last; child++)
+      if (heap->cmp(heap->items[child], heap->items[least]) < 0)
+        least = child;
+    if (heap->cmp(heap->items[least], item) >= 0) break;
+    _heap_place(heap, i, heap->items[least], heap->slots[least]);
+    i = (unsigned int) least;
+  }
+  _heap_place(heap, i, item, slot);
+}
+
+static int _heap_resize(heap_t* heap, unsigned int capacity) {
+  // Grown one at a time, so a failure leaves the heap as it was.
+  item_t* items = realloc(heap->items, capacity * sizeof(item_t));
+  if (items == NULL) return -1;
+  heap->items = items;
+  unsigned int* slots = realloc(heap->slots, capacity * sizeof(unsigned int));
+  if (slots == NULL) return -1;
+  heap->slots = slots;
+  unsigned int* positions = realloc(heap->positions, capacity * sizeof(unsigned int));
+  if (positions == NULL) return -1;
+  heap->positions = positions;
+  unsigned int* generations = realloc(heap->generations, capacity * sizeof(unsigned int));
+  if (generations == NULL) return -1;
+  heap->generations = generations;
+  heap->capacity = capacity;
+  return 0;
+}
+
+// Makes room for one more item, doubling the capacity when full.
+static int _heap_grow(heap_t* heap) {
+  if (heap->length < heap->capacity) return 0;
+  if (heap->capacity >= INT_MAX) return -1;
+  unsigned int capacity = heap->capacity ? heap->capacity * 2 : HEAP_MIN_CAPACITY;
+  if (capacity > INT_MAX)
+    capacity = INT_MAX;
+  return _heap_resize(heap, capacity);
+}
+
+// Starts off with room for `capacity` items, allocating nothing if 0.
+// Items come out smallest first by `cmp`, or by `item_compare` when
+// NULL. For the largest first, give a comparator which turns the order
+// around.
+// Returns NULL if Malloc fails.
+heap_t* heap_new(unsigned int capacity, item_cmp_t cmp) {
+  heap_t* heap = calloc(1, sizeof(heap_t));
+  if (heap == NULL) return NULL;
+  heap->cmp = cmp ? cmp : item_compare;
+  heap->free_slot = _HEAP_NO_SLOT;
+  if (capacity > INT_MAX
+      || (capacity && _heap_resize(heap, capacity) == -1)) {
+    heap_free(heap);
+    return NULL;
+  }
+  return heap;
+}
+
+// Makes a heap holding a copy of `count` items, in O(n), which beats
+// pushing them one by one. The handle of each item is its position in
+// `items`, as each slot starts at generation 0.
+// Returns NULL if Malloc fails.
+heap_t* heap_from_array(const item_t* items, unsigned int count, item_cmp_t cmp) {
+  heap_t* heap = heap_new(count, cmp);
+  if (heap == NULL) return NULL;
+  if (count == 0) return heap;
+
+  memcpy(heap->items, items, count * sizeof(item_t));
+  for (unsigned int i = 0; i < count; i++) {
+    heap->slots[i] = i;
+    heap->positions[i] = i;
+    heap->generations[i] = 0;
+  }
+  heap->length = count;
+  heap->slots_used = count;
+  // Floyd's method, sifting down every item with children, from the
+  // bottom up. Most items are near the bottom and barely move.
+  if (count > 1)
+    for (int i = _heap_parent(count - 1); i >= 0; i--)
+      _heap_sift_down(heap, (unsigned int) i);
+  return heap;
+}
+
+void heap_free(heap_t* heap) {
+  for (unsigned int i = 0; i < heap->length; i++)
+    item_free(heap->items[i]);
+  free(heap->items);
+  free(heap->slots);
+  free(heap->positions);
+  free(heap->generations);
+  free(heap);
+}
+
+int heap_empty(const heap_t* heap) {
+  return heap->length == 0;
+}
+
+int heap_length(const heap_t* heap) {
+  return (int) heap->length;
+}
+
+// Adds an item, and returns the handle which finds it again.
+// Returns HEAP_NO_HANDLE if Malloc fails.
+heap_handle_t heap_push(heap_t* heap, item_t item) {
+  if (_heap_grow(heap) == -1) return HEAP_NO_HANDLE;
+
+  // There are never more slots than items the heap has room for.
+  unsigned int slot = heap->free_slot;
+  if (slot == _HEAP_NO_SLOT) {
+    slot = heap->slots_used++;
+    heap->generations[slot] = 0;
+  } else {
+    unsigned int next = heap->positions[slot];
+    heap->free_slot = next == _HEAP_NO_SLOT ? next : next & ~_HEAP_FREE;
+  }
+
+  unsigned int i = heap->length++;
+  _heap_place(heap, i, item, slot);
+  _heap_sift_up(heap, i);
+  return _heap_handle(heap, slot);
+}
+
+// Returns the smallest item, leaving it in the heap, or NULL if empty.
+item_t* heap_peek(const heap_t* heap) {
+  if (heap->length == 0) return NULL;
+  return &heap->items[0];
+}
+
+// Takes out the item at position `i`, and gives its slot back, in a new
+// generation so its old handle stops working.
+static item_t _heap_take(heap_t* heap, unsigned int i) {
+  item_t item = heap->items[i];
+  unsigned int slot = heap->slots[i];
+  heap->positions[slot] = heap->free_slot | _HEAP_FREE;
+  heap->generations[slot] += 1;
+  heap->free_slot = slot;
+
+  // The last item fills the hole, and moves whichever way it has to.
+  heap->length -= 1;
+  if (i < heap->length) {
+    unsigned int last = heap->length;
+    _heap_place(heap, i, heap->items[last], heap->slots[last]);
+    if (i > 0 && heap->cmp(heap->items[i], heap->items[_heap_parent(i)]) < 0)
+      _heap_sift_up(heap, i);
+    else
+      _heap_sift_down(heap, i);
+  }
+  return item;
+}
+
+// Removes the smallest item.
+// Caller must handle deallocating possible pointers inside returned item_t.
+// Returns ITEM_NULL if empty, which you should check for.
+item_t heap_pop(heap_t* heap) {
+  if (heap->length == 0) return ITEM_NULL;
+  return _heap_take(heap, 0);
+}
+
+// Returns the position of the item of a handle, or -1 if the handle is
+// not in use, be it never given out or its item gone.
+static int _heap_position(const heap_t* heap, heap_handle_t handle) {
+  unsigned int slot = (unsigned int) handle;
+  if (slot >= heap->slots_used || heap->positions[slot] & _HEAP_FREE
+      || heap->generations[slot] != (unsigned int) (handle >> 32))
+    return -1;
+  return (int) heap->positions[slot];
+}
+
+// Returns the item of a handle, or NULL if the handle is not in use.
+// Only valid until the heap is next changed, as items move around.
+item_t* heap_get(const heap_t* heap, heap_handle_t handle) {
+  int i = _heap_position(heap, handle);
+  if (i == -1) return NULL;
+  return &heap->items[i];
+}
+
+// Replaces the item of a handle, moving it to where its new value goes,
+// be it smaller (as in decrease-key) or larger. The old item is not
+// freed. Returns -1 if the handle is not in use.
+int heap_update(heap_t* heap, heap_handle_t handle, item_t item) {
+  int i = _heap_position(heap, handle);
+  if (i == -1) return -1;
+  heap->items[i] = item;
+  if (i > 0 && heap->cmp(item, heap->items[_heap_parent((unsigned int) i)]) < 0)
+    _heap_sift_up(heap, (unsigned int) i);
+  else
+    _heap_sift_down(heap, (unsigned int) i);
+  return 0;
+}
+
+// Removes the item of a handle, wherever it is in the heap.
+// Caller must handle deallocating possible pointers inside returned item_t.
+// Returns ITEM_NULL if the handle is not in use.
+item_t heap_remove(heap_t* heap, heap_handle_t handle) {
+  int i = _heap_position(heap, handle);
+  if (i == -1) return ITEM_NULL;
+  return _heap_take(heap, (unsigned int) i);
+}
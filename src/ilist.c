@@ -0,0 +1,211 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include "item.h"
+#include "ilist.h"
+
+// An indexable skip list, as per William Pugh's "Skip Lists: A
+// Probabilistic Alternative to Balanced Trees" (1990), where each link
+// also records how many positions it skips. Looking up, inserting and
+// removing at a position all take O(log n) expected time, instead of the
+// O(n) walk of `list_at`.
+//
+// Every node is on level 0, and each level above holds about a quarter
+// of the nodes of the level below it. A search goes as far as it can on
+// the highest level, then drops down a level, summing link widths until
+// it has skipped the wanted amount of positions.
+//
+// Items stay in place once inserted, so pointers to them remain valid
+// until they are removed.
+
+ilist_t* ilist_new(void) {
+  ilist_t* list = calloc(1, sizeof(ilist_t));
+  if (list == NULL) return NULL;
+  list->head = malloc(sizeof(inode_t) + ILIST_MAX_LEVEL * sizeof(ilink_t));
+  if (list->head == NULL) {
+    free(list);
+    return NULL;
+  }
+
+  list->head->item = ITEM_NULL;
+  list->head->level = ILIST_MAX_LEVEL;
+  for (unsigned int l = 0; l < ILIST_MAX_LEVEL; l++) {
+    list->head->links[l].next = NULL;
+    list->head->links[l].width = 1;
+  }
+  // A fixed seed, so the shape of a list only depends on its operations.
+  list->rng = 0x9E3779B97F4A7C15ull;
+  return list;
+}
+
+void ilist_free(ilist_t* list) {
+  inode_t* current = list->head->links[0].next;
+  while (current) {
+    inode_t* next = current->links[0].next;
+    item_free(current->item);
+    free(current);
+    current = next;
+  }
+  free(list->head);
+  free(list);
+}
+
+int ilist_empty(const ilist_t* list) {
+  return list->length == 0;
+}
+
+int ilist_length(const ilist_t* list) {
+  return (int) list->length;
+}
+
+// Each level is reached with a chance of 1/4, using two random bits a
+// level (xorshift64, by George Marsaglia).
+static unsigned int _ilist_random_level(ilist_t* list) {
+  unsigned long long x = list->rng;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  list->rng = x;
+
+  unsigned int level = 1;
+  while (level < ILIST_MAX_LEVEL && (x & 3) == 0) {
+    level += 1;
+    x >>= 2;
+  }
+  return level;
+}
+
+// Turns a negative position into one counted from the end. Returns -1
+// if out of bounds, where `end` is the largest valid position.
+static int _ilist_pos(const ilist_t* list, int pos, int end) {
+  if (pos < 0)
+    pos += (int) list->length;
+  if (pos < 0 || pos > end) return -1;
+  return pos;
+}
+
+// Fills in the last node on each level which comes before position
+// `pos`, and how many positions into the list each of them is (the head
+// being at 0, and the item at `pos` at `pos + 1`).
+static void _ilist_search(const ilist_t* list, unsigned int pos, inode_t** update, unsigned int* rank) {
+  inode_t* current = list->head;
+  unsigned int r = 0;
+  // An empty list has no levels, but its position 0 still follows the head.
+  update[0] = current;
+  if (rank)
+    rank[0] = 0;
+  for (unsigned int l = list->level; l-- > 0;) {
+    while (current->links[l].next && r + current->links[l].width <= pos) {
+      r += current->links[l].width;
+      current = current->links[l].next;
+    }
+    update[l] = current;
+    if (rank)
+      rank[l] = r;
+  }
+}
+
+// Inserts the item so it ends up at position `pos`, which may also be
+// the length of the list to add it at the end. Returns the stored item,
+// or NULL if out of bounds or if Malloc fails.
+item_t* ilist_insert(ilist_t* list, int pos, item_t item) {
+  pos = _ilist_pos(list, pos, (int) list->length);
+  if (pos == -1) return NULL;
+
+  unsigned int level = _ilist_random_level(list);
+  inode_t* node = malloc(sizeof(inode_t) + level * sizeof(ilink_t));
+  if (node == NULL) return NULL;
+  node->item = item;
+  node->level = level;
+
+  inode_t* update[ILIST_MAX_LEVEL];
+  unsigned int rank[ILIST_MAX_LEVEL];
+  _ilist_search(list, pos, update, rank);
+  for (; list->level < level; list->level++) {
+    // A new level, its only link so far goes from the head to the end.
+    update[list->level] = list->head;
+    rank[list->level] = 0;
+    list->head->links[list->level].next = NULL;
+    list->head->links[list->level].width = list->length + 1;
+  }
+
+  for (unsigned int l = 0; l < list->level; l++) {
+    ilink_t* link = &update[l]->links[l];
+    if (l < level) {
+      // Split the link in two, around the new node.
+      unsigned int before = pos + 1 - rank[l];
+      node->links[l].next = link->next;
+      node->links[l].width = link->width + 1 - before;
+      link->next = node;
+      link->width = before;
+    } else {
+      link->width += 1;
+    }
+  }
+
+  list->length += 1;
+  return &node->item;
+}
+
+// Adds an item at the start of the list.
+item_t* ilist_prepend(ilist_t* list, item_t item) {
+  return ilist_insert(list, 0, item);
+}
+
+// Adds an item at the end of the list.
+item_t* ilist_append(ilist_t* list, item_t item) {
+  return ilist_insert(list, (int) list->length, item);
+}
+
+// Caller must handle deallocating possible pointers inside returned item_t.
+// Returns ITEM_NULL if out of bounds, which you should check for.
+item_t ilist_remove(ilist_t* list, int pos) {
+  pos = _ilist_pos(list, pos, (int) list->length - 1);
+  if (pos == -1) return ITEM_NULL;
+
+  inode_t* update[ILIST_MAX_LEVEL];
+  _ilist_search(list, pos, update, NULL);
+  inode_t* node = update[0]->links[0].next;
+
+  for (unsigned int l = 0; l < list->level; l++) {
+    ilink_t* link = &update[l]->links[l];
+    if (link->next == node) {
+      // Join the links on either side of the node.
+      link->width += node->links[l].width - 1;
+      link->next = node->links[l].next;
+    } else {
+      link->width -= 1;
+    }
+  }
+  while (list->level > 0 && list->head->links[list->level - 1].next == NULL)
+    list->level -= 1;
+
+  item_t item = node->item;
+  free(node);
+  list->length -= 1;
+  return item;
+}
+
+// Returns the item at position `pos`, counting from the end when
+// negative. Returns NULL if out of bounds.
+item_t* ilist_at(const ilist_t* list, int pos) {
+  pos = _ilist_pos(list, pos, (int) list->length - 1);
+  if (pos == -1) return NULL;
+
+  inode_t* update[ILIST_MAX_LEVEL];
+  _ilist_search(list, pos, update, NULL);
+  return &update[0]->links[0].next->item;
+}
+
+// Returns the position of the first equal item, or -1 if none are.
+int ilist_find(const ilist_t* list, item_t item) {
+  int pos = 0;
+  for (inode_t* node = list->head->links[0].next; node; node = node->links[0].next, pos++)
+    if (item_equal(node->item, item)) return pos;
+  // We didn't find anything.
+  return -1;
+}
@@ -4,13 +4,77 @@
 // clause) to any licence for distributing derivative works that have
 // been produced by the normal use of the Work as a library.
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "item.h"
+#include "wyhash.h"
+
+// Returns a copy of the string as an `h` item, which caches the length
+// and hash of the string. Returns ITEM_NULL if Malloc fails.
+item_t item_str(const char* str) {
+  size_t len = strlen(str);
+  item_str_t* h = malloc(sizeof(item_str_t) + len + 1);
+  if (h == NULL) return ITEM_NULL;
+
+  h->len = len;
+  h->hash = hash_wy(str, len, 0);
+  memcpy(h->str, str, len + 1);
+  return (item_t) { .type = 'h', .data.h = h };
+}
+
+_Static_assert(sizeof(item_t) == ITEM_INLINE_MAX + 2, "inline strings must not grow item_t");
+
+// Returns a copy of the string as a `q` item when it is short enough to
+// fit in the item itself, saving an allocation, and as an `s` item
+// otherwise. Returns ITEM_NULL if Malloc fails.
+item_t item_string(const char* str) {
+  size_t len = strlen(str);
+  if (len <= ITEM_INLINE_MAX) {
+    item_t item;
+    memset(&item, 0, sizeof(item));
+    item.type = 'q';
+    memcpy(item.q + 1, str, len);
+    return item;
+  }
+
+  char* copy = malloc(len + 1);
+  if (copy == NULL) return ITEM_NULL;
+  memcpy(copy, str, len + 1);
+  return (item_t) { .type = 's', .data.s = copy };
+}
+
+// Returns the string held by any kind of string item, or NULL if it is
+// not a string. Points into the item itself for `q` items.
+const char* item_cstr(const item_t* item) {
+  switch (item->type) {
+    case 'q':
+      return item->q + 1;
+    case 'h':
+      return item->data.h->str;
+    case 's':
+    case 'S':
+      return item->data.s;
+  };
+  return NULL;
+}
 
 // A non zero return value means its equal.
 int item_equal(item_t left, item_t right) {
-  if (left.type == right.type || ((left.type == 's' || left.type == 'S') && (right.type == 's' || right.type == 'S')))
+  if (left.type == 'q' && right.type == 'q')
+    // Zero padded, so the whole items can be compared.
+    return memcmp(left.q, right.q, sizeof(left.q)) == 0;
+  if (left.type == 'h' && right.type == 'h')
+    // Differing lengths or hashes settle most comparisons early.
+    return left.data.h->len == right.data.h->len
+           && left.data.h->hash == right.data.h->hash
+           && memcmp(left.data.h->str, right.data.h->str, left.data.h->len) == 0;
+  const char* left_str = item_cstr(&left);
+  const char* right_str = item_cstr(&right);
+  if (left_str && right_str)
+    // Any kind of string can be compared with any other.
+    return (strcmp(left_str, right_str) == 0);
+  if (left.type == right.type)
     switch (left.type) {
       case 'i':
         return (left.data.i == right.data.i);
@@ -18,20 +82,96 @@ int item_equal(item_t left, item_t right) {
         return (left.data.d == right.data.d);
       case 'c':
         return (left.data.c == right.data.c);
-      case 's':
-      case 'S':
-        // Both `s` and `S` are defined as `char *`, so this is okay for lookup of either.
-        return (strcmp(left.data.s, right.data.s) == 0);
       case 'p':
         return (left.data.p == right.data.p);
     };
   return 0;
 }
 
+// Places items of different kinds apart, with all strings together.
+static int _item_rank(char type) {
+  return type == 'q' || type == 'h' || type == 'S' ? 's' : type;
+}
+
+// The natural order of items, as used by `item_sort` when not given a
+// comparator. Items are ordered by kind first, and then by value, where
+// strings of any kind compare as by `strcmp`. NaN is larger than any
+// other double, and -0.0 is equal to 0.0, as in `item_equal`.
+int item_compare(item_t left, item_t right) {
+  int left_rank = _item_rank(left.type);
+  int right_rank = _item_rank(right.type);
+  if (left_rank != right_rank) return left_rank < right_rank ? -1 : 1;
+
+  switch (left_rank) {
+    case 's': {
+      int order = strcmp(item_cstr(&left), item_cstr(&right));
+      return (order > 0) - (order < 0);
+    }
+    case 'i':
+      return (left.data.i > right.data.i) - (left.data.i < right.data.i);
+    case 'd': {
+      double l = left.data.d;
+      double r = right.data.d;
+      if (l != l || r != r) return (l != l) - (r != r);
+      return (l > r) - (l < r);
+    }
+    case 'c':
+      return (left.data.c > right.data.c) - (left.data.c < right.data.c);
+    case 'p': {
+      uintptr_t l = (uintptr_t) left.data.p;
+      uintptr_t r = (uintptr_t) right.data.p;
+      return (l > r) - (l < r);
+    }
+  };
+  return 0;
+}
+
+// Spreads the bits of a small value over the whole hash (the finalizer
+// of splitmix64, by Sebastiano Vigna).
+static unsigned long _item_mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return (unsigned long) (x ^ (x >> 31));
+}
+
+// Hashes an item, such that equal items (by `item_equal`) hash the same.
+// Strings of any kind hash as `hash_wy` with a seed of 0, which `h` items
+// have cached.
+unsigned long item_hash(item_t item) {
+  switch (item.type) {
+    case 'h':
+      return item.data.h->hash;
+    case 'q':
+    case 's':
+    case 'S': {
+      const char* str = item_cstr(&item);
+      return hash_wy(str, strlen(str), 0);
+    }
+    case 'i':
+      return _item_mix((uint64_t) (unsigned int) item.data.i);
+    case 'd': {
+      // 0.0 and -0.0 are equal, but differ in their sign bit.
+      double d = item.data.d == 0.0 ? 0.0 : item.data.d;
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      return _item_mix(bits);
+    }
+    case 'c':
+      return _item_mix((uint64_t) (unsigned char) item.data.c);
+    case 'p':
+      return _item_mix((uint64_t) (uintptr_t) item.data.p);
+  };
+  return 0;
+}
+
 void item_free(item_t item) {
   switch (item.type) {
+    case 'h':
+      free(item.data.h);
+      break;
     case 's':
       free(item.data.s);
+      break;
     case 'p':
       free(item.data.p);
   };
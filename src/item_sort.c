@@ -0,0 +1,182 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "item.h"
+
+// Sorting of item arrays. Arrays of only `i` or only `d` items in their
+// natural order are radix sorted, everything else goes through an
+// introsort: a quicksort which falls back to heapsort when it keeps
+// picking bad pivots, so it stays O(n log n) on any input.
+
+// Below this, insertion sort beats partitioning any further.
+#define SORT_INSERTION_MAX 16
+// Below this, radix sorting is not worth its extra buffer.
+#define SORT_RADIX_MIN 256
+
+static void _sort_swap(item_t* left, item_t* right) {
+  item_t tmp = *left;
+  *left = *right;
+  *right = tmp;
+}
+
+static void _sort_insertion(item_t* items, size_t count, item_cmp_t cmp) {
+  for (size_t i = 1; i < count; i++) {
+    item_t item = items[i];
+    size_t j = i;
+    for (; j > 0 && cmp(item, items[j - 1]) < 0; j--)
+      items[j] = items[j - 1];
+    items[j] = item;
+  }
+}
+
+static void _sort_sift_down(item_t* items, size_t root, size_t count, item_cmp_t cmp) {
+  for (;;) {
+    size_t child = 2 * root + 1;
+    if (child >= count) return;
+    if (child + 1 < count && cmp(items[child], items[child + 1]) < 0)
+      child += 1;
+    if (cmp(items[root], items[child]) >= 0) return;
+    _sort_swap(&items[root], &items[child]);
+    root = child;
+  }
+}
+
+static void _sort_heap(item_t* items, size_t count, item_cmp_t cmp) {
+  for (size_t i = count / 2; i > 0; i--)
+    _sort_sift_down(items, i - 1, count, cmp);
+  for (size_t end = count - 1; end > 0; end--) {
+    _sort_swap(&items[0], &items[end]);
+    _sort_sift_down(items, 0, end, cmp);
+  }
+}
+
+static void _sort_intro(item_t* items, size_t count, unsigned int depth, item_cmp_t cmp) {
+  while (count > SORT_INSERTION_MAX) {
+    if (depth == 0) {
+      _sort_heap(items, count, cmp);
+      return;
+    }
+    depth -= 1;
+
+    // Median of three, which also leaves a sentinel at either end for
+    // the partitioning below.
+    size_t mid = count / 2;
+    item_t* last = &items[count - 1];
+    if (cmp(items[mid], items[0]) < 0) _sort_swap(&items[mid], &items[0]);
+    if (cmp(*last, items[mid]) < 0) {
+      _sort_swap(last, &items[mid]);
+      if (cmp(items[mid], items[0]) < 0) _sort_swap(&items[mid], &items[0]);
+    }
+    _sort_swap(&items[mid], &items[1]);
+    item_t pivot = items[1];
+
+    // Hoare partition, where items equal to the pivot stop both sides so
+    // runs of equal items still split evenly.
+    size_t i = 1;
+    size_t j = count - 1;
+    for (;;) {
+      do i++; while (cmp(items[i], pivot) < 0);
+      do j--; while (cmp(pivot, items[j]) < 0);
+      if (i >= j) break;
+      _sort_swap(&items[i], &items[j]);
+    }
+    _sort_swap(&items[1], &items[j]);
+
+    // Recurse into the smaller side, loop on the larger one.
+    size_t left = j;
+    size_t right = count - j - 1;
+    if (left < right) {
+      _sort_intro(items, left, depth, cmp);
+      items += j + 1;
+      count = right;
+    } else {
+      _sort_intro(items + j + 1, right, depth, cmp);
+      count = left;
+    }
+  }
+  _sort_insertion(items, count, cmp);
+}
+
+// Maps an item to an unsigned key in the same order as `item_compare`.
+static uint64_t _sort_key(item_t item) {
+  if (item.type == 'i')
+    return (uint32_t) item.data.i ^ 0x80000000u;
+
+  double d = item.data.d;
+  if (d != d) return UINT64_MAX; // NaN goes last.
+  if (d == 0.0) d = 0.0; // Folds -0.0 into 0.0.
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  // Flip all bits of negatives so they order backwards, and just the
+  // sign bit of positives so they come after them.
+  return bits & 0x8000000000000000ull ? ~bits : bits | 0x8000000000000000ull;
+}
+
+// Least significant digit first, a byte at a time, skipping bytes which
+// are the same for every item (such as the upper bytes of small ints).
+// Stable. Returns -1 if Malloc fails.
+static int _sort_radix(item_t* items, size_t count, unsigned int bytes) {
+  item_t* buffer = malloc(count * sizeof(item_t));
+  if (buffer == NULL) return -1;
+
+  item_t* from = items;
+  item_t* to = buffer;
+  for (unsigned int shift = 0; shift < bytes * 8; shift += 8) {
+    size_t counts[256] = { 0 };
+    for (size_t i = 0; i < count; i++)
+      counts[(_sort_key(from[i]) >> shift) & 0xFF] += 1;
+    if (counts[(_sort_key(from[0]) >> shift) & 0xFF] == count) continue;
+
+    size_t offset = 0;
+    for (unsigned int digit = 0; digit < 256; digit++) {
+      size_t digit_count = counts[digit];
+      counts[digit] = offset;
+      offset += digit_count;
+    }
+    for (size_t i = 0; i < count; i++)
+      to[counts[(_sort_key(from[i]) >> shift) & 0xFF]++] = from[i];
+
+    item_t* tmp = from;
+    from = to;
+    to = tmp;
+  }
+  if (from != items)
+    memcpy(items, from, count * sizeof(item_t));
+  free(buffer);
+  return 0;
+}
+
+// Returns the type all items share, or 0 if they differ.
+static char _sort_common_type(const item_t* items, size_t count) {
+  char type = items[0].type;
+  for (size_t i = 1; i < count; i++)
+    if (items[i].type != type) return 0;
+  return type;
+}
+
+// Sorts an array of items in place, by `cmp`, or by `item_compare` when
+// NULL. Not stable, unless all items are `i` or all are `d` and sorted
+// in their natural order, which is done with a stable radix sort.
+void item_sort(item_t* items, size_t count, item_cmp_t cmp) {
+  if (count < 2) return;
+  if (cmp == NULL)
+    cmp = item_compare;
+
+  if (cmp == item_compare && count >= SORT_RADIX_MIN) {
+    char type = _sort_common_type(items, count);
+    // If Malloc fails, carry on with the introsort, which needs none.
+    if (type == 'i' && _sort_radix(items, count, sizeof(uint32_t)) == 0) return;
+    if (type == 'd' && _sort_radix(items, count, sizeof(uint64_t)) == 0) return;
+  }
+
+  unsigned int depth = 0;
+  for (size_t n = count; n > 1; n >>= 1)
+    depth += 2;
+  _sort_intro(items, count, depth, cmp);
+}
@@ -0,0 +1,143 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+#include "list.h"
+#include "lhash.h"
+
+// A hash table which remembers the order of its keys, by keeping them in
+// a doubly-linked list as well. The table maps each key to its node in
+// the list, and nodes never move in memory, so finding, reordering and
+// removing a key are all O(1). Evicting the oldest key is just removing
+// the last node of the list.
+//
+// By default the order is that of insertion. With LHASH_ACCESS_ORDER a
+// get also moves its key to the front, which makes the oldest key the
+// least recently used one, as in an LRU cache.
+
+lhash_t* lhash_new(unsigned int size) {
+  return lhash_new_flags(size, 0);
+}
+
+lhash_t* lhash_new_flags(unsigned int size, unsigned int flags) {
+  lhash_t* map = calloc(1, sizeof(lhash_t));
+  if (map == NULL) return NULL;
+  map->flags = flags;
+
+  // Keys may well come from outside, so seed the table. Owned keys, as
+  // the nodes found by a key have to really be that key's.
+  map->index = hash_new_flags(size, HASH_GROWABLE | HASH_OWN_KEYS | HASH_SEEDED);
+  // A pool of our own, so the nodes of the list sit close together.
+  node_pool_t* pool = list_pool_new(0);
+  if (pool)
+    map->order = list_new_pooled(pool);
+  if (map->index == NULL || map->order == NULL) {
+    if (pool) list_pool_free(pool);
+    if (map->index) hash_free(map->index);
+    if (map->order) list_free(map->order);
+    free(map);
+    return NULL;
+  }
+  list_pool_free(pool);
+  return map;
+}
+
+// NOTE: Like `hash_free`, this does not free any values.
+void lhash_free(lhash_t* map) {
+  // Frees the entries along with the list, as they are `p` items.
+  list_free(map->order);
+  hash_free(map->index);
+  free(map);
+}
+
+static lhash_entry_t* _lhash_entry(node_t* node) {
+  return node->item.data.p;
+}
+
+// Unlinks and frees a key's node and entry, returning its value.
+static void* _lhash_drop(lhash_t* map, node_t* node) {
+  lhash_entry_t* entry = _lhash_entry(node);
+  void* value = entry->value;
+  (void) list_elem_remove(map->order, node);
+  free(entry);
+  return value;
+}
+
+// Return the value of a key, or NULL if it is not there.
+void* lhash_get(lhash_t* map, const char* key) {
+  node_t* node = hash_get(map->index, key);
+  if (node == NULL) return NULL;
+  if (map->flags & LHASH_ACCESS_ORDER)
+    list_elem_move(node, map->order);
+  return _lhash_entry(node)->value;
+}
+
+// Set and return the value of a key. New keys go to the front, and keys
+// already there keep their place, unless in access order.
+// Returns NULL if Malloc fails.
+void* lhash_put(lhash_t* map, const char* key, void* value) {
+  node_t* node = hash_get(map->index, key);
+  if (node) {
+    _lhash_entry(node)->value = value;
+    if (map->flags & LHASH_ACCESS_ORDER)
+      list_elem_move(node, map->order);
+    return value;
+  }
+
+  size_t len = strlen(key);
+  lhash_entry_t* entry = malloc(sizeof(lhash_entry_t) + len + 1);
+  if (entry == NULL) return NULL;
+  entry->value = value;
+  memcpy(entry->key, key, len + 1);
+
+  node = list_prepend(map->order, (item_t) { .type = 'p', .data.p = entry });
+  if (node == NULL) {
+    free(entry);
+    return NULL;
+  }
+  if (hash_put(map->index, key, node) == NULL) {
+    (void) _lhash_drop(map, node);
+    return NULL;
+  }
+  return value;
+}
+
+// Remove and return the value of a key.
+void* lhash_remove(lhash_t* map, const char* key) {
+  node_t* node = hash_remove(map->index, key);
+  if (node == NULL) return NULL;
+  return _lhash_drop(map, node);
+}
+
+// Makes a key the newest one. Returns -1 if it is not there.
+int lhash_move_to_front(lhash_t* map, const char* key) {
+  node_t* node = hash_get(map->index, key);
+  if (node == NULL) return -1;
+  list_elem_move(node, map->order);
+  return 0;
+}
+
+// Returns the oldest key, which `lhash_evict` would remove next, or NULL
+// if empty. Only valid until that key is removed.
+const char* lhash_oldest(lhash_t* map) {
+  if (list_empty(map->order)) return NULL;
+  return _lhash_entry(map->order->prev)->key;
+}
+
+// Removes the oldest key and returns its value. Returns NULL if empty.
+void* lhash_evict(lhash_t* map) {
+  if (list_empty(map->order)) return NULL;
+  node_t* node = map->order->prev;
+  (void) hash_remove(map->index, _lhash_entry(node)->key);
+  return _lhash_drop(map, node);
+}
+
+// Returns the count of keys in the map.
+int lhash_count(const lhash_t* map) {
+  return hash_count(map->index);
+}
@@ -5,18 +5,128 @@
 // been produced by the normal use of the Work as a library.
 
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "item.h"
 #include "list.h"
 
+// The sentinel is allocated as the start of a larger header, holding
+// what belongs to the list as a whole. Nodes do not point back at it, to
+// stay as small as they were, so changing a list by one of its nodes
+// takes the sentinel along with it.
+typedef struct ListHead {
+  node_t sentinel;
+  node_pool_t* pool; // NULL when nodes are allocated one by one.
+  int length;
+} _list_head_t;
+
+static _list_head_t* _list_head(node_t* const sentinel) {
+  return (_list_head_t*) sentinel;
+}
+
+// A pool starts off with `slab_nodes` nodes (or LIST_POOL_SLAB if 0),
+// and doubles the size of every following slab.
+node_pool_t* list_pool_new(unsigned int slab_nodes) {
+  node_pool_t* pool = calloc(1, sizeof(node_pool_t));
+  if (pool == NULL) return NULL;
+  pool->slab_nodes = slab_nodes ? slab_nodes : LIST_POOL_SLAB;
+  pool->refs = 1;
+  return pool;
+}
+
+// Drops a reference to the pool, freeing all of its slabs at once when
+// it was the last one.
+void list_pool_free(node_pool_t* pool) {
+  pool->refs -= 1;
+  if (pool->refs != 0) return;
+
+  node_slab_t* slab = pool->slabs;
+  while (slab) {
+    node_slab_t* next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  free(pool);
+}
+
+static node_slab_t* _list_pool_slab(node_pool_t* pool, size_t nodes) {
+  node_slab_t* slab = malloc(sizeof(node_slab_t) + nodes * sizeof(node_t));
+  if (slab == NULL) return NULL;
+  slab->next = pool->slabs;
+  pool->slabs = slab;
+  return slab;
+}
+
+// Starts bumping from a fresh slab, doubling the size of the next one.
+static int _list_pool_grow(node_pool_t* pool) {
+  node_slab_t* slab = _list_pool_slab(pool, pool->slab_nodes);
+  if (slab == NULL) return -1;
+  pool->bump = slab->nodes;
+  pool->bump_end = slab->nodes + pool->slab_nodes;
+  if (pool->slab_nodes <= UINT_MAX / 2 / sizeof(node_t))
+    pool->slab_nodes *= 2;
+  return 0;
+}
+
+static node_t* _list_pool_alloc(node_pool_t* pool) {
+  if (pool->free) {
+    node_t* node = pool->free;
+    pool->free = node->next;
+    return node;
+  }
+  if (pool->bump == pool->bump_end && _list_pool_grow(pool) == -1)
+    return NULL;
+  return pool->bump++;
+}
+
+// Hands out `count` nodes next to each other. Runs larger than a whole
+// slab get a slab of their own, leaving the current one to bump from.
+static node_t* _list_pool_alloc_run(node_pool_t* pool, size_t count) {
+  if (count > pool->slab_nodes) {
+    node_slab_t* slab = _list_pool_slab(pool, count);
+    return slab ? slab->nodes : NULL;
+  }
+  if ((size_t) (pool->bump_end - pool->bump) < count && _list_pool_grow(pool) == -1)
+    return NULL;
+  node_t* run = pool->bump;
+  pool->bump += count;
+  return run;
+}
+
+static node_t* _list_node_alloc(node_pool_t* pool) {
+  if (pool == NULL) return malloc(sizeof(node_t));
+  return _list_pool_alloc(pool);
+}
+
+static void _list_node_release(node_pool_t* pool, node_t* node) {
+  if (pool == NULL) {
+    free(node);
+    return;
+  }
+  node->next = pool->free;
+  pool->free = node;
+}
+
 // A circular doubly-linked list with a sentinel.
 // Generated list should always point to the sentinel.
 // Any item's defined as pointers/strings should be always heap allocated.
 // Returns the sentinel position in the list. Do not change the pointer.
 node_t* list_new(void) {
-  node_t* sentinel = calloc(1, sizeof(node_t));
-  if (sentinel == NULL) return NULL;
+  return list_new_pooled(NULL);
+}
+
+// Like `list_new`, but takes the list's nodes from `pool`, which can be
+// shared with other lists. Nodes are only ever handed back to the pool,
+// and the pool is freed along with the last list (or reference) to it.
+node_t* list_new_pooled(node_pool_t* pool) {
+  _list_head_t* head = calloc(1, sizeof(_list_head_t));
+  if (head == NULL) return NULL;
+  node_t* sentinel = &head->sentinel;
+  if (pool)
+    pool->refs += 1;
+  head->pool = pool;
 
   // Create the sentinel, it's identfiable by being an item whose value
   // points to itself. By design it's not set to NULL, as the caller may
@@ -31,15 +141,21 @@ node_t* list_new(void) {
 }
 
 void list_free(node_t* const sentinel) {
+  node_pool_t* pool = _list_head(sentinel)->pool;
+  // Nodes of a pool nobody else uses are released with it, all at once.
+  int release = pool == NULL || pool->refs > 1;
   node_t* current = sentinel;
   node_t* next = current->next;
   current = next; // Skip the sentinel.
   while (current != sentinel) {
     next = current->next;
     item_free(current->item);
-    free(current);
+    if (release)
+      _list_node_release(pool, current);
     current = next;
   }
+  if (pool)
+    list_pool_free(pool);
   // Lastly, free our sentinel.
   free(sentinel);
 }
@@ -49,14 +165,16 @@ int list_elem_is_sentinel(node_t* elem) {
 }
 
 int list_empty(node_t* const sentinel) {
-  return sentinel->prev == sentinel->next && list_elem_is_sentinel(sentinel);
+  return sentinel->next == sentinel && list_elem_is_sentinel(sentinel);
 }
 
-// Insert to the right of the list element given.
+// Insert to the right of the list element given, which has to be in the
+// list of `sentinel` (or be the sentinel itself).
 // Returns the new list element which holds the new item.
 // Could return NULL if Malloc fails.
-node_t* list_elem_insert(node_t* left_elem, item_t item) {
-  node_t* middle_elem = calloc(1, sizeof(node_t));
+node_t* list_elem_insert(node_t* const sentinel, node_t* left_elem, item_t item) {
+  _list_head_t* head = _list_head(sentinel);
+  node_t* middle_elem = _list_node_alloc(head->pool);
   if (middle_elem == NULL) return NULL;
   node_t* right_elem = left_elem->next;
 
@@ -68,6 +186,7 @@ node_t* list_elem_insert(node_t* left_elem, item_t item) {
   left_elem->next = middle_elem;
   right_elem->prev = middle_elem;
 
+  head->length += 1;
   return middle_elem;
 }
 
@@ -75,17 +194,18 @@ node_t* list_elem_insert(node_t* left_elem, item_t item) {
 node_t* list_prepend(node_t* const sentinel, item_t item) {
   // Recasting sentinel as its contract does not require the sentinel
   // as its argument (which is what const tries to convey).
-  return list_elem_insert((node_t*) sentinel, item);
+  return list_elem_insert(sentinel, (node_t*) sentinel, item);
 }
 
 // Adds an element at the end of the list.
 node_t* list_append(node_t* const sentinel, item_t item) {
-  return list_elem_insert(sentinel->prev, item);
+  return list_elem_insert(sentinel, sentinel->prev, item);
 }
 
+// Removes an element of the list of `sentinel`.
 // Caller must handle deallocating possible pointers inside returned item_t.
 // May fail on empty list, returns ITEM_NULL that you should check for.
-item_t list_elem_remove(node_t* elem) {
+item_t list_elem_remove(node_t* const sentinel, node_t* elem) {
   if (list_elem_is_sentinel(elem)) return ITEM_NULL;
 
   node_t* left = elem->prev;
@@ -96,30 +216,243 @@ item_t list_elem_remove(node_t* elem) {
 
   item_t item = elem->item;
 
-  free(elem);
+  _list_head_t* head = _list_head(sentinel);
+  head->length -= 1;
+  _list_node_release(head->pool, elem);
   return item;
 }
 
-// Returns NULL if out of bounds.
-node_t* list_at(node_t* const sentinel, int pos) {
-  node_t* current = sentinel;
-  if (list_empty(sentinel)) return NULL;
-  if (pos == 0) return sentinel->next;
-  if (pos < 0) {
-    do {
-      pos += 1;
-      current = current->prev;
-      if (current == sentinel) return NULL;
-    } while(pos != 0);
+// Moves an element to the right of `left_elem`, which has to be in the
+// same list. Unlike removing and inserting it again, the element keeps
+// its node, so pointers to it stay valid.
+void list_elem_move(node_t* elem, node_t* left_elem) {
+  if (elem == left_elem || list_elem_is_sentinel(elem)) return;
+
+  elem->prev->next = elem->next;
+  elem->next->prev = elem->prev;
+
+  node_t* right_elem = left_elem->next;
+  elem->prev = left_elem;
+  elem->next = right_elem;
+  left_elem->next = elem;
+  right_elem->prev = elem;
+}
+
+// Moves the elements from `first` to `last` (both included, in order) of
+// the list of `other` to the right of `left_elem` in the list of
+// `sentinel`, keeping their nodes. The lists have to share their pool,
+// and may be the same list as long as `left_elem` is not in the range.
+// Only relinks the ends of the range, except that part of another list
+// has to be walked, to count the elements moved.
+// Returns -1 if the lists do not share their pool.
+int list_splice(node_t* const sentinel, node_t* left_elem, node_t* const other, node_t* first, node_t* last) {
+  _list_head_t* to = _list_head(sentinel);
+  _list_head_t* from = _list_head(other);
+  if (to->pool != from->pool) return -1;
+  if (list_elem_is_sentinel(first) || list_elem_is_sentinel(last)) return -1;
+
+  if (to != from) {
+    int count = from->length;
+    if (first->prev != other || last->next != other) {
+      count = 1;
+      for (node_t* current = first; current != last; current = current->next)
+        count++;
+    }
+    from->length -= count;
+    to->length += count;
+  }
+
+  first->prev->next = last->next;
+  last->next->prev = first->prev;
+
+  node_t* right_elem = left_elem->next;
+  first->prev = left_elem;
+  last->next = right_elem;
+  left_elem->next = first;
+  right_elem->prev = last;
+  return 0;
+}
+
+// Moves all elements of `other` to the end of the list, leaving `other`
+// empty, in O(1) and without allocating.
+// Returns -1 if the lists do not share their pool.
+int list_concat(node_t* const sentinel, node_t* const other) {
+  if (_list_head(sentinel)->pool != _list_head(other)->pool) return -1;
+  if (sentinel == other || list_empty(other)) return 0;
+  return list_splice(sentinel, sentinel->prev, other, other->next, other->prev);
+}
+
+// Splits the list in two at position `pos`, counting from the end when
+// negative. The elements from `pos` on move over to a new list, which
+// shares the pool of the old one and is returned. Splitting at the
+// length of the list returns an empty list.
+// Returns NULL if out of bounds or if Malloc fails.
+node_t* list_split_at(node_t* const sentinel, int pos) {
+  int length = _list_head(sentinel)->length;
+  if (pos < 0)
+    pos += length;
+  if (pos < 0 || pos > length) return NULL;
+
+  node_t* rest = list_new_pooled(_list_head(sentinel)->pool);
+  if (rest == NULL) return NULL;
+  if (pos == length) return rest;
+
+  (void) list_splice(rest, rest, sentinel, list_at(sentinel, pos), sentinel->prev);
+  return rest;
+}
+
+// Adds `count` items at the end of the list, in order. A pooled list
+// takes all the nodes it needs from its pool in one go, next to each
+// other. Either every item is added or none are.
+// Returns -1 if Malloc fails.
+int list_append_array(node_t* const sentinel, const item_t* items, int count) {
+  if (count <= 0) return 0;
+  _list_head_t* head = _list_head(sentinel);
+
+  node_t* run = NULL;
+  if (head->pool) {
+    run = _list_pool_alloc_run(head->pool, (size_t) count);
+    if (run == NULL) return -1;
+  }
+
+  // Link up the new elements among themselves first, so that nothing
+  // needs to be undone in the list if Malloc fails halfway.
+  node_t* first = NULL;
+  node_t* last = NULL;
+  for (int i = 0; i < count; i++) {
+    node_t* node = run ? &run[i] : malloc(sizeof(node_t));
+    if (node == NULL) {
+      while (last) {
+        node_t* prev = last->prev;
+        free(last);
+        last = prev;
+      }
+      return -1;
+    }
+    node->item = items[i];
+    node->prev = last;
+    if (last)
+      last->next = node;
+    else
+      first = node;
+    last = node;
   }
-  if (pos > 0) {
+
+  node_t* left_elem = sentinel->prev;
+  first->prev = left_elem;
+  last->next = sentinel;
+  left_elem->next = first;
+  sentinel->prev = last;
+  head->length += count;
+  return 0;
+}
+
+// Merges two sorted runs linked through `next`, ending in NULL. Takes
+// from `left` on ties, so a stable sort stays stable.
+static node_t* _list_merge(node_t* left, node_t* right, item_cmp_t cmp) {
+  node_t head;
+  node_t* tail = &head;
+  while (left && right) {
+    if (cmp(right->item, left->item) < 0) {
+      tail->next = right;
+      right = right->next;
+    } else {
+      tail->next = left;
+      left = left->next;
+    }
+    tail = tail->next;
+  }
+  tail->next = left ? left : right;
+  return head.next;
+}
+
+// Sorts the list by `cmp`, or by `item_compare` when NULL. A stable,
+// bottom-up merge sort, which relinks the nodes instead of moving the
+// items, so elements keep their items and nothing is allocated.
+void list_sort(node_t* const sentinel, item_cmp_t cmp) {
+  if (cmp == NULL)
+    cmp = item_compare;
+  if (sentinel->next->next == sentinel) return;
+
+  // Nodes are taken one at a time and merged up a ladder of runs, where
+  // `runs[k]` is either empty or a run of 2^k nodes. Runs higher up came
+  // earlier in the list. Merges thus stay between runs of equal size
+  // (which is what keeps this O(n log n)), and work on nodes which were
+  // recently touched.
+  node_t* runs[sizeof(int) * CHAR_BIT] = { NULL };
+  sentinel->prev->next = NULL;
+  node_t* current = sentinel->next;
+  while (current) {
+    node_t* run = current;
     current = current->next;
-    do {
-      pos -= 1;
+    run->next = NULL;
+
+    unsigned int k = 0;
+    for (; runs[k]; k++) {
+      run = _list_merge(runs[k], run, cmp);
+      runs[k] = NULL;
+    }
+    runs[k] = run;
+  }
+
+  node_t* sorted = NULL;
+  for (unsigned int k = 0; k < sizeof(runs) / sizeof(runs[0]); k++)
+    if (runs[k])
+      sorted = sorted ? _list_merge(runs[k], sorted, cmp) : runs[k];
+
+  // Only `next` was kept up to date, so fix up `prev` in one last pass.
+  node_t* left_elem = (node_t*) sentinel;
+  for (current = sorted; current; current = current->next) {
+    current->prev = left_elem;
+    left_elem->next = current;
+    left_elem = current;
+  }
+  left_elem->next = (node_t*) sentinel;
+  ((node_t*) sentinel)->prev = left_elem;
+}
+
+// Like `list_sort`, but gathers the items into an array and sorts that
+// with `item_sort`, before writing them back in order. Usually faster
+// on large lists, as the sort itself never chases pointers, and `i` and
+// `d` items can be radix sorted. Elements do not keep their items, and
+// the sort is not stable except for those radix sorts.
+// Returns -1 if Malloc fails, leaving the list as it was.
+int list_sort_array(node_t* const sentinel, item_cmp_t cmp) {
+  size_t length = (size_t) _list_head(sentinel)->length;
+  if (length < 2) return 0;
+  item_t* items = malloc(length * sizeof(item_t));
+  if (items == NULL) return -1;
+
+  size_t i = 0;
+  for (node_t* current = sentinel->next; current != sentinel; current = current->next)
+    items[i++] = current->item;
+  item_sort(items, length, cmp);
+  i = 0;
+  for (node_t* current = sentinel->next; current != sentinel; current = current->next)
+    current->item = items[i++];
+
+  free(items);
+  return 0;
+}
+
+// Returns the element at position `pos`, counting from the end when
+// negative. Walks from whichever end is closer. Returns NULL if out of
+// bounds.
+node_t* list_at(node_t* const sentinel, int pos) {
+  int length = _list_head(sentinel)->length;
+  if (pos < 0)
+    pos += length;
+  if (pos < 0 || pos >= length) return NULL;
+
+  node_t* current = sentinel->next;
+  if (pos <= length / 2) {
+    for (; pos != 0; pos--)
       current = current->next;
-      if (current == sentinel) return NULL;
-    } while(pos != 0);
-  };
+  } else {
+    current = sentinel->prev;
+    for (pos = length - 1 - pos; pos != 0; pos--)
+      current = current->prev;
+  }
   return current;
 }
 
@@ -133,12 +466,44 @@ node_t* list_find(node_t* const sentinel, item_t item) {
   return NULL;
 }
 
+// Like `list_find` with an `i` item, without going through `item_equal`
+// for every element.
+node_t* list_find_int(node_t* const sentinel, int value) {
+  for (node_t* current = sentinel->next; current != sentinel; current = current->next)
+    if (current->item.type == 'i' && current->item.data.i == value) return current;
+  return NULL;
+}
+
+// Like `list_find` with a string item, matching strings of any kind. The
+// length and hash of `h` items rule out most of them without reading
+// their bytes, and other strings are only compared when their first
+// byte matches (which for `q` items is in the node itself).
+node_t* list_find_str(node_t* const sentinel, const char* str) {
+  size_t len = strlen(str);
+  unsigned long str_hash = 0;
+  int hashed = 0;
+
+  for (node_t* current = sentinel->next; current != sentinel; current = current->next) {
+    item_t item = current->item;
+    if (item.type == 'h') {
+      if (item.data.h->len != len) continue;
+      // Only hash the string once an `h` item of equal length shows up.
+      if (!hashed) {
+        str_hash = item_hash((item_t) { .type = 'S', .data.S = (char*) str });
+        hashed = 1;
+      }
+      if (item.data.h->hash == str_hash && memcmp(item.data.h->str, str, len) == 0)
+        return current;
+    } else if (item.type == 's' || item.type == 'S' || item.type == 'q') {
+      const char* item_str = item_cstr(&current->item);
+      if (item_str[0] == str[0] && strcmp(item_str, str) == 0)
+        return current;
+    }
+  }
+  return NULL;
+}
+
+// Kept up to date by every insert and remove.
 int list_length(node_t* const sentinel) {
-  node_t* cur = sentinel->next;
-  int count = 0;
-  while (cur != sentinel) {
-    count += 1;
-    cur = cur->next;
-  };
-  return count;
+  return _list_head(sentinel)->length;
 }
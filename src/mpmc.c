@@ -0,0 +1,109 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "item.h"
+#include "mpmc.h"
+
+// A bounded multi-producer multi-consumer queue, after Dmitry Vyukov's
+// "Bounded MPMC queue". Any amount of threads may append and remove at
+// once, without locks and without allocating.
+//
+// The cells form a ring, each with a sequence number. A cell is free for
+// the producer claiming position `pos` when its sequence is `pos`, and
+// full for the consumer claiming `pos` when it is `pos + 1`. A position
+// is claimed with a compare and swap on `enqueue_pos` or `dequeue_pos`,
+// after which only the claiming thread touches the cell's item, until it
+// hands the cell on by bumping its sequence.
+//
+// Source: https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+
+// Rounds the size up to a power of two, at least 2.
+mpmc_t* mpmc_new(unsigned int size) {
+  size_t capacity = 2;
+  while (capacity < size)
+    capacity *= 2;
+
+  mpmc_t* queue = calloc(1, sizeof(mpmc_t));
+  if (queue == NULL) return NULL;
+  queue->cells = calloc(capacity, sizeof(mpmc_cell_t));
+  if (queue->cells == NULL) {
+    free(queue);
+    return NULL;
+  }
+
+  queue->mask = capacity - 1;
+  for (size_t i = 0; i < capacity; i++)
+    atomic_init(&queue->cells[i].sequence, i);
+  atomic_init(&queue->enqueue_pos, 0);
+  atomic_init(&queue->dequeue_pos, 0);
+  return queue;
+}
+
+// NOTE: Items still in the queue are not freed. No other thread may be
+// using the queue anymore.
+void mpmc_free(mpmc_t* queue) {
+  free(queue->cells);
+  free(queue);
+}
+
+// Adds an item at the end of the queue. Returns -1 if the queue is full.
+int mpmc_append(mpmc_t* queue, item_t item) {
+  mpmc_cell_t* cell;
+  size_t pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+  for (;;) {
+    cell = &queue->cells[pos & queue->mask];
+    size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    intptr_t diff = (intptr_t) sequence - (intptr_t) pos;
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&queue->enqueue_pos, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return -1; // The cell still holds an item from a lap ago.
+    } else {
+      pos = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+    }
+  }
+
+  cell->item = item;
+  atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+  return 0;
+}
+
+// Removes the item at the start of the queue.
+// May fail on empty queue, returns ITEM_NULL that you should check for.
+item_t mpmc_remove(mpmc_t* queue) {
+  mpmc_cell_t* cell;
+  size_t pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+  for (;;) {
+    cell = &queue->cells[pos & queue->mask];
+    size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    intptr_t diff = (intptr_t) sequence - (intptr_t) (pos + 1);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&queue->dequeue_pos, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return ITEM_NULL; // Nothing was appended here yet.
+    } else {
+      pos = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+    }
+  }
+
+  item_t item = cell->item;
+  // Free for the producer which comes by one lap later.
+  atomic_store_explicit(&cell->sequence, pos + queue->mask + 1, memory_order_release);
+  return item;
+}
+
+// Amount of items in the queue. Only a snapshot while others use it.
+int mpmc_length(mpmc_t* queue) {
+  size_t dequeued = atomic_load_explicit(&queue->dequeue_pos, memory_order_relaxed);
+  size_t enqueued = atomic_load_explicit(&queue->enqueue_pos, memory_order_relaxed);
+  return enqueued > dequeued ? (int) (enqueued - dequeued) : 0;
+}
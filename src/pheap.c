@@ -0,0 +1,185 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include "item.h"
+#include "pheap.h"
+
+// A priority queue, as a pairing heap: a tree where each node is no
+// larger than its children, with any amount of children a node. Pushing,
+// peeking, melding two heaps and decreasing an item are O(1), while
+// popping the smallest item is O(log n) amortized.
+//
+// Each item lives in its own node, which never moves, so the node a
+// push returns finds its item for as long as it is in the heap. Compared
+// to `heap_t` this pays a node allocation a push, and chases pointers
+// on a pop, but melding does not copy anything.
+//
+// Source: Fredman, Sedgewick, Sleator and Tarjan, "The pairing heap: A
+// new form of self-adjusting heap", 1986.
+
+// Starts off empty. Items come out smallest first by `cmp`, or by
+// `item_compare` when NULL.
+// Returns NULL if Malloc fails.
+pheap_t* pheap_new(item_cmp_t cmp) {
+  pheap_t* heap = calloc(1, sizeof(pheap_t));
+  if (heap == NULL) return NULL;
+  heap->cmp = cmp ? cmp : item_compare;
+  return heap;
+}
+
+void pheap_free(pheap_t* heap) {
+  // Flattens the tree as it goes, moving the children of each node in
+  // front of its siblings, so freeing needs no stack.
+  pnode_t* node = heap->root;
+  while (node) {
+    if (node->child) {
+      pnode_t* last = node->child;
+      while (last->next)
+        last = last->next;
+      last->next = node->next;
+      node->next = node->child;
+      node->child = NULL;
+    }
+    pnode_t* next = node->next;
+    item_free(node->item);
+    free(node);
+    node = next;
+  }
+  free(heap);
+}
+
+int pheap_empty(const pheap_t* heap) {
+  return heap->root == NULL;
+}
+
+int pheap_length(const pheap_t* heap) {
+  return (int) heap->length;
+}
+
+// Joins two trees, making the larger root the first child of the other,
+// and returns the root of the result. Either may be NULL.
+static pnode_t* _pheap_link(const pheap_t* heap, pnode_t* left, pnode_t* right) {
+  if (left == NULL) return right;
+  if (right == NULL) return left;
+  if (heap->cmp(right->item, left->item) < 0) {
+    pnode_t* swap = left;
+    left = right;
+    right = swap;
+  }
+  right->prev = left;
+  right->next = left->child;
+  if (left->child)
+    left->child->prev = right;
+  left->child = right;
+  left->next = NULL;
+  left->prev = NULL;
+  return left;
+}
+
+// Joins a list of siblings into one tree, in two passes: linking them
+// in pairs from the left, and then the pairs into one from the right.
+// The order is what makes popping O(log n) amortized.
+static pnode_t* _pheap_merge_pairs(const pheap_t* heap, pnode_t* first) {
+  // The pairs are kept in a list through `prev`, last pair first.
+  pnode_t* pairs = NULL;
+  while (first) {
+    pnode_t* second = first->next;
+    pnode_t* rest = second ? second->next : NULL;
+    pnode_t* pair = _pheap_link(heap, first, second);
+    pair->prev = pairs;
+    pairs = pair;
+    first = rest;
+  }
+
+  pnode_t* root = NULL;
+  while (pairs) {
+    pnode_t* next = pairs->prev;
+    root = _pheap_link(heap, pairs, root);
+    pairs = next;
+  }
+  return root;
+}
+
+// Adds an item, and returns its node, which finds it again.
+// Returns NULL if Malloc fails.
+pnode_t* pheap_push(pheap_t* heap, item_t item) {
+  pnode_t* node = calloc(1, sizeof(pnode_t));
+  if (node == NULL) return NULL;
+  node->item = item;
+  heap->root = _pheap_link(heap, heap->root, node);
+  heap->length += 1;
+  return node;
+}
+
+// Returns the smallest item, leaving it in the heap, or NULL if empty.
+item_t* pheap_peek(const pheap_t* heap) {
+  if (heap->root == NULL) return NULL;
+  return &heap->root->item;
+}
+
+// Removes the smallest item, freeing its node.
+// Caller must handle deallocating possible pointers inside returned item_t.
+// Returns ITEM_NULL if empty, which you should check for.
+item_t pheap_pop(pheap_t* heap) {
+  pnode_t* root = heap->root;
+  if (root == NULL) return ITEM_NULL;
+  item_t item = root->item;
+  heap->root = _pheap_merge_pairs(heap, root->child);
+  heap->length -= 1;
+  free(root);
+  return item;
+}
+
+// Takes a node which is not the root out of the tree, along with its
+// children.
+static void _pheap_cut(pnode_t* node) {
+  if (node->prev->child == node)
+    node->prev->child = node->next;
+  else
+    node->prev->next = node->next;
+  if (node->next)
+    node->next->prev = node->prev;
+  node->next = NULL;
+  node->prev = NULL;
+}
+
+// Replaces the item of a node with one no larger, as in decrease-key.
+// The old item is not freed. For a larger item, remove the node and
+// push it again.
+// Returns -1 if the item is larger, leaving the heap as it was.
+int pheap_decrease(pheap_t* heap, pnode_t* node, item_t item) {
+  if (heap->cmp(item, node->item) > 0) return -1;
+  node->item = item;
+  if (node != heap->root) {
+    _pheap_cut(node);
+    heap->root = _pheap_link(heap, heap->root, node);
+  }
+  return 0;
+}
+
+// Removes the item of a node, wherever it is in the heap, freeing the
+// node.
+// Caller must handle deallocating possible pointers inside returned item_t.
+item_t pheap_remove(pheap_t* heap, pnode_t* node) {
+  if (node == heap->root) return pheap_pop(heap);
+  item_t item = node->item;
+  _pheap_cut(node);
+  heap->root = _pheap_link(heap, heap->root, _pheap_merge_pairs(heap, node->child));
+  heap->length -= 1;
+  free(node);
+  return item;
+}
+
+// Moves all items of `other` into the heap, leaving `other` empty. The
+// nodes of `other` stay valid, now in the heap. Both heaps should order
+// their items by the same comparator.
+void pheap_meld(pheap_t* heap, pheap_t* other) {
+  heap->root = _pheap_link(heap, heap->root, other->root);
+  heap->length += other->length;
+  other->root = NULL;
+  other->length = 0;
+}
@@ -0,0 +1,205 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include <string.h>
+#include "item.h"
+#include "ulist.h"
+
+// An unrolled circular doubly-linked list with a sentinel. Each node
+// holds up to ULIST_NODE_ITEMS items next to each other, so walking the
+// list takes one pointer hop per node instead of one per item. Items are
+// addressed by their position in the list, as in `list_at`.
+//
+// Nodes are split in half when inserting into a full one, and merged
+// with their successor once both fit in one node after a remove, which
+// keeps nodes at least about half full.
+//
+// Returns the sentinel position in the list. Do not change the pointer.
+unode_t* ulist_new(void) {
+  unode_t* sentinel = calloc(1, sizeof(unode_t));
+  if (sentinel == NULL) return NULL;
+
+  sentinel->prev = sentinel;
+  sentinel->next = sentinel;
+
+  return sentinel;
+}
+
+void ulist_free(unode_t* const sentinel) {
+  unode_t* current = sentinel->next;
+  while (current != sentinel) {
+    unode_t* next = current->next;
+    for (unsigned int i = 0; i < current->count; i++)
+      item_free(current->items[i]);
+    free(current);
+    current = next;
+  }
+  free(sentinel);
+}
+
+int ulist_empty(unode_t* const sentinel) {
+  return sentinel->count == 0;
+}
+
+int ulist_length(unode_t* const sentinel) {
+  return (int) sentinel->count;
+}
+
+// Links a new, empty node to the right of `left`.
+static unode_t* _ulist_node_insert(unode_t* left) {
+  unode_t* node = malloc(sizeof(unode_t));
+  if (node == NULL) return NULL;
+  node->count = 0;
+
+  node->prev = left;
+  node->next = left->next;
+  left->next->prev = node;
+  left->next = node;
+
+  return node;
+}
+
+static void _ulist_node_remove(unode_t* node) {
+  node->prev->next = node->next;
+  node->next->prev = node->prev;
+  free(node);
+}
+
+// Turns a negative position into one counted from the end. Returns -1
+// if out of bounds, where `end` is the largest valid position.
+static int _ulist_pos(unode_t* const sentinel, int pos, int end) {
+  if (pos < 0)
+    pos += (int) sentinel->count;
+  if (pos < 0 || pos > end) return -1;
+  return pos;
+}
+
+// Finds the node holding the item at a valid position, walking from
+// whichever end of the list is closer.
+static unode_t* _ulist_locate(unode_t* const sentinel, unsigned int pos, unsigned int* offset) {
+  unode_t* node;
+  if (pos < sentinel->count / 2) {
+    node = sentinel->next;
+    while (pos >= node->count) {
+      pos -= node->count;
+      node = node->next;
+    }
+    *offset = pos;
+  } else {
+    unsigned int from_end = sentinel->count - 1 - pos;
+    node = sentinel->prev;
+    while (from_end >= node->count) {
+      from_end -= node->count;
+      node = node->prev;
+    }
+    *offset = node->count - 1 - from_end;
+  }
+  return node;
+}
+
+// Inserts the item so it ends up at position `pos`, which may also be
+// the length of the list to add it at the end.
+// Returns -1 if out of bounds or if Malloc fails.
+int ulist_insert(unode_t* const sentinel, int pos, item_t item) {
+  pos = _ulist_pos(sentinel, pos, (int) sentinel->count);
+  if (pos == -1) return -1;
+
+  unode_t* node;
+  unsigned int offset;
+  if ((unsigned int) pos == sentinel->count) {
+    node = sentinel->prev;
+    offset = node->count;
+  } else {
+    node = _ulist_locate(sentinel, pos, &offset);
+  }
+
+  if (node == sentinel || offset == ULIST_NODE_ITEMS) {
+    // Adding past the last item, start off a fresh node. Appending thus
+    // leaves every node full.
+    node = _ulist_node_insert(node);
+    if (node == NULL) return -1;
+    offset = 0;
+  } else if (node->count == ULIST_NODE_ITEMS) {
+    // Split the node, moving its upper half into a new node.
+    unode_t* right = _ulist_node_insert(node);
+    if (right == NULL) return -1;
+    unsigned int half = ULIST_NODE_ITEMS / 2;
+    memcpy(right->items, node->items + half, (ULIST_NODE_ITEMS - half) * sizeof(item_t));
+    right->count = ULIST_NODE_ITEMS - half;
+    node->count = half;
+    if (offset > half) {
+      node = right;
+      offset -= half;
+    }
+  }
+
+  memmove(node->items + offset + 1, node->items + offset, (node->count - offset) * sizeof(item_t));
+  node->items[offset] = item;
+  node->count += 1;
+  sentinel->count += 1;
+  return 0;
+}
+
+// Adds an item at the start of the list.
+int ulist_prepend(unode_t* const sentinel, item_t item) {
+  return ulist_insert(sentinel, 0, item);
+}
+
+// Adds an item at the end of the list.
+int ulist_append(unode_t* const sentinel, item_t item) {
+  return ulist_insert(sentinel, (int) sentinel->count, item);
+}
+
+// Caller must handle deallocating possible pointers inside returned item_t.
+// Returns ITEM_NULL if out of bounds, which you should check for.
+item_t ulist_remove(unode_t* const sentinel, int pos) {
+  pos = _ulist_pos(sentinel, pos, (int) sentinel->count - 1);
+  if (pos == -1) return ITEM_NULL;
+
+  unsigned int offset;
+  unode_t* node = _ulist_locate(sentinel, pos, &offset);
+  item_t item = node->items[offset];
+
+  node->count -= 1;
+  memmove(node->items + offset, node->items + offset + 1, (node->count - offset) * sizeof(item_t));
+  sentinel->count -= 1;
+
+  unode_t* next = node->next;
+  if (node->count == 0) {
+    _ulist_node_remove(node);
+  } else if (node->count < ULIST_NODE_ITEMS / 2 && next != sentinel
+             && node->count + next->count <= ULIST_NODE_ITEMS) {
+    memcpy(node->items + node->count, next->items, next->count * sizeof(item_t));
+    node->count += next->count;
+    _ulist_node_remove(next);
+  }
+  return item;
+}
+
+// Returns the item at position `pos`, counting from the end when
+// negative. Returns NULL if out of bounds. The pointer is only valid
+// until the list is next changed, as items move between nodes.
+item_t* ulist_at(unode_t* const sentinel, int pos) {
+  pos = _ulist_pos(sentinel, pos, (int) sentinel->count - 1);
+  if (pos == -1) return NULL;
+
+  unsigned int offset;
+  unode_t* node = _ulist_locate(sentinel, pos, &offset);
+  return &node->items[offset];
+}
+
+// Returns the position of the first equal item, or -1 if none are.
+int ulist_find(unode_t* const sentinel, item_t item) {
+  int pos = 0;
+  for (unode_t* node = sentinel->next; node != sentinel; node = node->next) {
+    for (unsigned int i = 0; i < node->count; i++)
+      if (item_equal(node->items[i], item)) return pos + (int) i;
+    pos += (int) node->count;
+  }
+  // We didn't find anything.
+  return -1;
+}
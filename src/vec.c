@@ -0,0 +1,161 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "item.h"
+#include "vec.h"
+
+// A growable array of items, kept next to each other in one allocation.
+// Appending and removing at the end are amortized O(1), as the capacity
+// doubles whenever it runs out, and indexing is always O(1). Scanning
+// walks memory in order, which the CPU prefetches well.
+//
+// Pointers to items are only valid until the vector is next changed, as
+// growing may move all of them.
+
+// Starts off with room for `capacity` items, allocating nothing if 0.
+// Returns NULL if Malloc fails.
+vec_t* vec_new(unsigned int capacity) {
+  vec_t* vec = calloc(1, sizeof(vec_t));
+  if (vec == NULL) return NULL;
+  if (capacity && vec_reserve(vec, capacity) == -1) {
+    free(vec);
+    return NULL;
+  }
+  return vec;
+}
+
+void vec_free(vec_t* vec) {
+  for (unsigned int i = 0; i < vec->length; i++)
+    item_free(vec->items[i]);
+  free(vec->items);
+  free(vec);
+}
+
+int vec_empty(const vec_t* vec) {
+  return vec->length == 0;
+}
+
+int vec_length(const vec_t* vec) {
+  return (int) vec->length;
+}
+
+static int _vec_resize(vec_t* vec, unsigned int capacity) {
+  item_t* items = realloc(vec->items, capacity * sizeof(item_t));
+  if (items == NULL) return -1;
+  vec->items = items;
+  vec->capacity = capacity;
+  return 0;
+}
+
+// Makes room for at least `capacity` items, so that appending up to
+// that many never has to allocate.
+// Returns -1 if Malloc fails, or if more items are asked for than a
+// position can address.
+int vec_reserve(vec_t* vec, unsigned int capacity) {
+  if (capacity <= vec->capacity) return 0;
+  if (capacity > INT_MAX) return -1;
+  return _vec_resize(vec, capacity);
+}
+
+// Gives back the capacity not in use, freeing all of it when empty.
+// Returns -1 if Malloc fails, leaving the vector as it was.
+int vec_shrink(vec_t* vec) {
+  if (vec->length == vec->capacity) return 0;
+  if (vec->length == 0) {
+    free(vec->items);
+    vec->items = NULL;
+    vec->capacity = 0;
+    return 0;
+  }
+  return _vec_resize(vec, vec->length);
+}
+
+// Makes room for one more item, doubling the capacity when full.
+static int _vec_grow(vec_t* vec) {
+  if (vec->length < vec->capacity) return 0;
+  if (vec->capacity >= INT_MAX) return -1;
+  unsigned int capacity = vec->capacity ? vec->capacity * 2 : VEC_MIN_CAPACITY;
+  if (capacity > INT_MAX)
+    capacity = INT_MAX;
+  return _vec_resize(vec, capacity);
+}
+
+// Turns a negative position into one counted from the end. Returns -1
+// if out of bounds, where `end` is the largest valid position.
+static int _vec_pos(const vec_t* vec, int pos, int end) {
+  if (pos < 0)
+    pos += (int) vec->length;
+  if (pos < 0 || pos > end) return -1;
+  return pos;
+}
+
+// Inserts the item so it ends up at position `pos`, moving the items
+// after it up by one. `pos` may also be the length of the vector to add
+// it at the end.
+// Returns -1 if out of bounds or if Malloc fails.
+int vec_insert(vec_t* vec, int pos, item_t item) {
+  pos = _vec_pos(vec, pos, (int) vec->length);
+  if (pos == -1) return -1;
+  if (_vec_grow(vec) == -1) return -1;
+
+  memmove(vec->items + pos + 1, vec->items + pos, (vec->length - pos) * sizeof(item_t));
+  vec->items[pos] = item;
+  vec->length += 1;
+  return 0;
+}
+
+// Adds an item at the end of the vector.
+// Returns -1 if Malloc fails.
+int vec_append(vec_t* vec, item_t item) {
+  if (_vec_grow(vec) == -1) return -1;
+  vec->items[vec->length++] = item;
+  return 0;
+}
+
+// Caller must handle deallocating possible pointers inside returned item_t.
+// Returns ITEM_NULL if out of bounds, which you should check for.
+item_t vec_remove(vec_t* vec, int pos) {
+  pos = _vec_pos(vec, pos, (int) vec->length - 1);
+  if (pos == -1) return ITEM_NULL;
+
+  item_t item = vec->items[pos];
+  vec->length -= 1;
+  memmove(vec->items + pos, vec->items + pos + 1, (vec->length - pos) * sizeof(item_t));
+  return item;
+}
+
+// Removes the last item. Keeps the capacity, see `vec_shrink`.
+// Returns ITEM_NULL if empty, which you should check for.
+item_t vec_pop(vec_t* vec) {
+  if (vec->length == 0) return ITEM_NULL;
+  vec->length -= 1;
+  return vec->items[vec->length];
+}
+
+// Returns the item at position `pos`, counting from the end when
+// negative. Returns NULL if out of bounds.
+item_t* vec_at(const vec_t* vec, int pos) {
+  pos = _vec_pos(vec, pos, (int) vec->length - 1);
+  if (pos == -1) return NULL;
+  return &vec->items[pos];
+}
+
+// Returns the position of the first equal item, or -1 if none are.
+int vec_find(const vec_t* vec, item_t item) {
+  for (unsigned int i = 0; i < vec->length; i++)
+    if (item_equal(vec->items[i], item)) return (int) i;
+  // We didn't find anything.
+  return -1;
+}
+
+// Sorts the vector by `cmp`, or by `item_compare` when NULL, see
+// `item_sort`.
+void vec_sort(vec_t* vec, item_cmp_t cmp) {
+  item_sort(vec->items, vec->length, cmp);
+}
@@ -0,0 +1,165 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include <string.h>
+#include "item.h"
+#include "wsdeque.h"
+
+// A work-stealing deque, as per David Chase and Yossi Lev's "Dynamic
+// Circular Work-Stealing Deque" (2005), with the memory orderings of
+// Nhat Minh Lê et al.'s "Correct and Efficient Work-Stealing for Weak
+// Memory Models" (2013).
+//
+// One thread owns the deque, and appends and removes items at its end
+// like a stack. Any other thread may steal items from its start. The
+// owner only synchronizes with thieves when they race for the very last
+// item, so a busy owner rarely pays for any atomic read-modify-write.
+//
+// When full, the owner moves the items into an array twice the size.
+// Thieves may still be reading the old array, so it is only freed along
+// with the deque.
+
+_Static_assert(sizeof(item_t) == sizeof(unsigned long long[2]), "an item must fit in a slot");
+
+static void _wsdeque_store(wsdeque_array_t* array, long i, item_t item) {
+  unsigned long long words[2];
+  memcpy(words, &item, sizeof(words));
+  wsdeque_slot_t* slot = &array->slots[i & (array->size - 1)];
+  atomic_store_explicit(&slot->words[0], words[0], memory_order_relaxed);
+  atomic_store_explicit(&slot->words[1], words[1], memory_order_relaxed);
+}
+
+// A thief may read a slot which is being overwritten, but will then
+// fail to claim it and throw the torn item away.
+static item_t _wsdeque_load(wsdeque_array_t* array, long i) {
+  unsigned long long words[2];
+  wsdeque_slot_t* slot = &array->slots[i & (array->size - 1)];
+  words[0] = atomic_load_explicit(&slot->words[0], memory_order_relaxed);
+  words[1] = atomic_load_explicit(&slot->words[1], memory_order_relaxed);
+  item_t item;
+  memcpy(&item, words, sizeof(item));
+  return item;
+}
+
+static wsdeque_array_t* _wsdeque_array_new(long size) {
+  wsdeque_array_t* array = malloc(sizeof(wsdeque_array_t) + size * sizeof(wsdeque_slot_t));
+  if (array == NULL) return NULL;
+  array->size = size;
+  array->retired = NULL;
+  return array;
+}
+
+// Rounds the size up to a power of two, at least 2.
+wsdeque_t* wsdeque_new(unsigned int size) {
+  long capacity = 2;
+  while (capacity < (long) size)
+    capacity *= 2;
+
+  wsdeque_t* deque = calloc(1, sizeof(wsdeque_t));
+  if (deque == NULL) return NULL;
+  wsdeque_array_t* array = _wsdeque_array_new(capacity);
+  if (array == NULL) {
+    free(deque);
+    return NULL;
+  }
+
+  atomic_init(&deque->array, array);
+  atomic_init(&deque->top, 0);
+  atomic_init(&deque->bottom, 0);
+  return deque;
+}
+
+// NOTE: Items still in the deque are not freed. No other thread may be
+// using the deque anymore.
+void wsdeque_free(wsdeque_t* deque) {
+  wsdeque_array_t* array = atomic_load(&deque->array);
+  while (array) {
+    wsdeque_array_t* retired = array->retired;
+    free(array);
+    array = retired;
+  }
+  free(deque);
+}
+
+static wsdeque_array_t* _wsdeque_grow(wsdeque_t* deque, wsdeque_array_t* array, long top, long bottom) {
+  wsdeque_array_t* grown = _wsdeque_array_new(array->size * 2);
+  if (grown == NULL) return NULL;
+  for (long i = top; i < bottom; i++)
+    _wsdeque_store(grown, i, _wsdeque_load(array, i));
+  grown->retired = array;
+  atomic_store_explicit(&deque->array, grown, memory_order_release);
+  return grown;
+}
+
+// Adds an item at the end of the deque. Only the owner may call this.
+// Returns -1 if Malloc fails while growing.
+int wsdeque_append(wsdeque_t* deque, item_t item) {
+  long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  wsdeque_array_t* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+  if (bottom - top > array->size - 1) {
+    array = _wsdeque_grow(deque, array, top, bottom);
+    if (array == NULL) return -1;
+  }
+
+  _wsdeque_store(array, bottom, item);
+  // Publishes the item to thieves.
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+  return 0;
+}
+
+// Removes the item at the end of the deque, the one appended last. Only
+// the owner may call this.
+// May fail on empty deque, returns ITEM_NULL that you should check for.
+item_t wsdeque_remove(wsdeque_t* deque) {
+  long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  wsdeque_array_t* array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+  // Reserve the item before looking at `top`, so that a thief either
+  // sees the reservation or we see its steal.
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_seq_cst);
+  long top = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+
+  if (top > bottom) {
+    // Was already empty.
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return ITEM_NULL;
+  }
+
+  item_t item = _wsdeque_load(array, bottom);
+  if (top == bottom) {
+    // The last item, which a thief may be after as well.
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+      item = ITEM_NULL;
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  }
+  return item;
+}
+
+// Removes the item at the start of the deque, the oldest one. Any thread
+// may call this.
+// May fail on empty deque, or when losing a race with another thread,
+// returns ITEM_NULL that you should check for.
+item_t wsdeque_steal(wsdeque_t* deque) {
+  long top = atomic_load_explicit(&deque->top, memory_order_seq_cst);
+  long bottom = atomic_load_explicit(&deque->bottom, memory_order_seq_cst);
+  if (top >= bottom) return ITEM_NULL;
+
+  wsdeque_array_t* array = atomic_load_explicit(&deque->array, memory_order_acquire);
+  item_t item = _wsdeque_load(array, top);
+  if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                               memory_order_seq_cst, memory_order_relaxed))
+    return ITEM_NULL;
+  return item;
+}
+
+// Amount of items in the deque. Only a snapshot while others use it.
+int wsdeque_length(wsdeque_t* deque) {
+  long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+  return bottom > top ? (int) (bottom - top) : 0;
+}
@@ -0,0 +1,109 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdint.h>
+#include <string.h>
+#include "wyhash.h"
+
+// Implementing the hash function `wyhash` (final version 4) by Wang Yi.
+// Unlike `djb2` it reads the key 4 to 16 bytes at a time and mixes them
+// with full 64x64->128 bit multiplies, so long keys hash several times
+// faster, and its seed changes the hash of every key. Keys are read in
+// native byte order, so hashes differ between big and little endian.
+//
+// Source: https://github.com/wangyi-fudan/wyhash
+
+static const uint64_t _wy_secret[4] = {
+  0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+  0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+};
+
+// Multiplies `a` and `b`, leaving the low half in `a` and high in `b`.
+static void _wy_mum(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t) *a * *b;
+  *a = (uint64_t) r;
+  *b = (uint64_t) (r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32);
+  uint64_t carry = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  carry += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static uint64_t _wy_mix(uint64_t a, uint64_t b) {
+  _wy_mum(&a, &b);
+  return a ^ b;
+}
+
+static uint64_t _wy_r8(const unsigned char* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t _wy_r4(const unsigned char* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// Reads 1 to 3 bytes, without branching on which.
+static uint64_t _wy_r3(const unsigned char* p, size_t len) {
+  return ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+}
+
+unsigned long hash_wy(const char* key, size_t len, unsigned long seed) {
+  const unsigned char* p = (const unsigned char*) key;
+  const uint64_t* secret = _wy_secret;
+  uint64_t s = seed;
+  uint64_t a, b;
+
+  s ^= _wy_mix(s ^ secret[0], secret[1]);
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (_wy_r4(p) << 32) | _wy_r4(p + ((len >> 3) << 2));
+      b = (_wy_r4(p + len - 4) << 32) | _wy_r4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = _wy_r3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+    if (i >= 48) {
+      // Three independent lanes, so the multiplies can overlap.
+      uint64_t s1 = s, s2 = s;
+      do {
+        s = _wy_mix(_wy_r8(p) ^ secret[1], _wy_r8(p + 8) ^ s);
+        s1 = _wy_mix(_wy_r8(p + 16) ^ secret[2], _wy_r8(p + 24) ^ s1);
+        s2 = _wy_mix(_wy_r8(p + 32) ^ secret[3], _wy_r8(p + 40) ^ s2);
+        p += 48;
+        i -= 48;
+      } while (i >= 48);
+      s ^= s1 ^ s2;
+    }
+    while (i > 16) {
+      s = _wy_mix(_wy_r8(p) ^ secret[1], _wy_r8(p + 8) ^ s);
+      i -= 16;
+      p += 16;
+    }
+    // The last 16 bytes, overlapping with what was already hashed.
+    a = _wy_r8(p + i - 16);
+    b = _wy_r8(p + i - 8);
+  }
+
+  a ^= secret[1];
+  b ^= s;
+  _wy_mum(&a, &b);
+  return (unsigned long) _wy_mix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
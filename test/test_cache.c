@@ -0,0 +1,156 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mtest.h"
+#include "cache.h"
+
+static int freed;
+static char last_freed[16];
+
+static void count_free(const char* key, void* value) {
+  (void) value;
+  freed += 1;
+  snprintf(last_freed, sizeof(last_freed), "%s", key);
+}
+
+static void heap_free(const char* key, void* value) {
+  (void) key;
+  free(value);
+}
+
+TEST_CASE(smoke, {
+  cache_t* cache = cache_new(10, 0, CACHE_LRU, count_free);
+  cache_stats_t stats;
+  int a = 1, b = 2;
+  freed = 0;
+
+  CHECK_TRUE(cache_get(cache, "Germany") == NULL);
+  CHECK_EQ_INT(cache_put(cache, "Germany", &a, 1), 0);
+  CHECK_TRUE(cache_get(cache, "Germany") == &a);
+
+  // Replacing a value frees the old one, but not the same one again.
+  CHECK_EQ_INT(cache_put(cache, "Germany", &a, 1), 0);
+  CHECK_EQ_INT(freed, 0);
+  CHECK_EQ_INT(cache_put(cache, "Germany", &b, 1), 0);
+  CHECK_EQ_INT(freed, 1);
+
+  // Removing hands the value back instead.
+  CHECK_TRUE(cache_remove(cache, "Germany") == &b);
+  CHECK_EQ_INT(freed, 1);
+
+  cache_stats(cache, &stats);
+  CHECK_EQ_INT(stats.count, 0);
+  CHECK_EQ_INT(stats.bytes, 0);
+  CHECK_EQ_INT(stats.hits, 1);
+  CHECK_EQ_INT(stats.misses, 1);
+  CHECK_EQ_INT(stats.evictions, 0);
+  CHECK_EQ_DOUBLE(stats.hit_rate, 0.5, 0.001);
+
+  cache_free(cache);
+})
+
+TEST_CASE(lru, {
+  cache_t* cache = cache_new(3, 0, CACHE_LRU, count_free);
+  int a = 1, b = 2, c = 3, d = 4;
+  freed = 0;
+
+  cache_put(cache, "a", &a, 0);
+  cache_put(cache, "b", &b, 0);
+  cache_put(cache, "c", &c, 0);
+  cache_get(cache, "a");
+  // "b" is now the least recently used.
+  cache_put(cache, "d", &d, 0);
+  CHECK_EQ_INT(freed, 1);
+  CHECK_TRUE(strcmp(last_freed, "b") == 0);
+  CHECK_TRUE(cache_get(cache, "b") == NULL);
+  CHECK_TRUE(cache_get(cache, "a") == &a);
+  CHECK_TRUE(cache_get(cache, "c") == &c);
+  CHECK_TRUE(cache_get(cache, "d") == &d);
+
+  cache_free(cache);
+  // The remaining three are freed along with the cache.
+  CHECK_EQ_INT(freed, 4);
+})
+
+TEST_CASE(clock, {
+  cache_t* cache = cache_new(3, 0, CACHE_CLOCK, count_free);
+  int a = 1, b = 2, c = 3, d = 4, e = 5;
+  freed = 0;
+
+  cache_put(cache, "a", &a, 0);
+  cache_put(cache, "b", &b, 0);
+  cache_put(cache, "c", &c, 0);
+  cache_get(cache, "a");
+  // "a" is the oldest, but was used since, so "b" goes.
+  cache_put(cache, "d", &d, 0);
+  CHECK_TRUE(strcmp(last_freed, "b") == 0);
+  // The second chance used up, "c" and then "a" are next.
+  cache_put(cache, "e", &e, 0);
+  CHECK_TRUE(strcmp(last_freed, "c") == 0);
+  CHECK_TRUE(cache_get(cache, "a") == &a);
+  CHECK_TRUE(cache_get(cache, "d") == &d);
+  CHECK_TRUE(cache_get(cache, "e") == &e);
+
+  cache_free(cache);
+})
+
+TEST_CASE(byte_budget, {
+  cache_t* cache = cache_new(0, 1000, CACHE_LRU, heap_free);
+  cache_stats_t stats;
+  char key[16];
+
+  // A value larger than the whole budget is refused.
+  CHECK_EQ_INT(cache_put(cache, "huge", NULL, 1001), -1);
+
+  for (int i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_EQ_INT(cache_put(cache, key, malloc(100), 100), 0);
+    cache_stats(cache, &stats);
+    CHECK_TRUE(stats.bytes <= 1000);
+  }
+  cache_stats(cache, &stats);
+  CHECK_EQ_INT(stats.count, 10);
+  CHECK_EQ_INT(stats.bytes, 1000);
+  CHECK_EQ_INT(stats.evictions, 90);
+
+  // One large value pushes out several small ones.
+  REQUIRE_EQ_INT(cache_put(cache, "large", malloc(450), 450), 0);
+  cache_stats(cache, &stats);
+  CHECK_EQ_INT(stats.count, 6);
+  CHECK_EQ_INT(stats.bytes, 950);
+  CHECK_TRUE(cache_get(cache, "key94") == NULL);
+  CHECK_TRUE(cache_get(cache, "key95") != NULL);
+
+  cache_free(cache);
+})
+
+TEST_CASE(replace_grows, {
+  cache_t* cache = cache_new(0, 300, CACHE_CLOCK, count_free);
+  cache_stats_t stats;
+  int a = 1, b = 2, c = 3, larger = 4;
+  freed = 0;
+
+  cache_put(cache, "a", &a, 100);
+  cache_put(cache, "b", &b, 100);
+  cache_put(cache, "c", &c, 100);
+  cache_get(cache, "b");
+  cache_get(cache, "c");
+  // The oldest key grows, and makes room by evicting the others, even
+  // the ones given a second chance, but never itself.
+  REQUIRE_EQ_INT(cache_put(cache, "a", &larger, 250), 0);
+  CHECK_EQ_INT(freed, 3);
+  CHECK_TRUE(cache_get(cache, "a") == &larger);
+  cache_stats(cache, &stats);
+  CHECK_EQ_INT(stats.count, 1);
+  CHECK_EQ_INT(stats.bytes, 250);
+
+  cache_free(cache);
+})
+
+MAIN_RUN_TESTS(smoke, lru, clock, byte_budget, replace_grows)
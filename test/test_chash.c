@@ -0,0 +1,163 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include "mtest.h"
+#include "chash.h"
+
+#define WRITERS 4
+#define READERS 4
+#define KEYS_PER_WRITER 20000
+
+static int values[WRITERS * KEYS_PER_WRITER];
+static chash_t* shared;
+static atomic_int writers_done;
+static atomic_int bad_reads;
+
+TEST_CASE(smoke, {
+  chash_t* hash = chash_new(4);
+  int a = 1, b = 2;
+
+  CHECK_TRUE(chash_get(hash, "Germany") == NULL);
+  CHECK_TRUE(chash_put(hash, "Germany", &a) == &a);
+  CHECK_TRUE(chash_get(hash, "Germany") == &a);
+  CHECK_TRUE(chash_put(hash, "Germany", &b) == &b);
+  CHECK_TRUE(chash_get(hash, "Germany") == &b);
+  CHECK_EQ_INT(chash_count(hash), 1);
+
+  // NULL marks removed keys, so it cannot be stored.
+  CHECK_TRUE(chash_put(hash, "Denmark", NULL) == NULL);
+  CHECK_EQ_INT(chash_count(hash), 1);
+
+  CHECK_TRUE(chash_remove(hash, "Germany") == &b);
+  CHECK_TRUE(chash_get(hash, "Germany") == NULL);
+  CHECK_TRUE(chash_remove(hash, "Germany") == NULL);
+  CHECK_EQ_INT(chash_count(hash), 0);
+
+  // A removed key can come back.
+  CHECK_TRUE(chash_put(hash, "Germany", &a) == &a);
+  CHECK_TRUE(chash_get(hash, "Germany") == &a);
+
+  chash_free(hash);
+})
+
+TEST_CASE(resize, {
+  chash_t* hash = chash_new(0);
+  char key[16];
+
+  for (int i = 0; i < 10000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(chash_put(hash, key, &values[i]) == &values[i]);
+    if (i % 3 == 0)
+      chash_remove(hash, key);
+  }
+  CHECK_EQ_INT(chash_count(hash), 10000 - 3334);
+  for (int i = 0; i < 10000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(chash_get(hash, key) == (i % 3 ? &values[i] : NULL));
+  }
+
+  chash_free(hash);
+})
+
+// Each writer owns a range of keys, which it puts and then removes every
+// other of, while the table is resized underneath everyone.
+static void* writer(void* arg) {
+  int first = (int) (size_t) arg * KEYS_PER_WRITER;
+  char key[16];
+  for (int i = first; i < first + KEYS_PER_WRITER; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    chash_put(shared, key, &values[i]);
+  }
+  for (int i = first; i < first + KEYS_PER_WRITER; i += 2) {
+    snprintf(key, sizeof(key), "key%d", i);
+    chash_remove(shared, key);
+  }
+  atomic_fetch_add(&writers_done, 1);
+  return NULL;
+}
+
+// A reader may see a key as missing or present, but never with the
+// value of another key.
+static void* reader(void* arg) {
+  unsigned int seed = (unsigned int) (size_t) arg;
+  char key[16];
+  while (atomic_load(&writers_done) != WRITERS) {
+    int i = rand_r(&seed) % (WRITERS * KEYS_PER_WRITER);
+    snprintf(key, sizeof(key), "key%d", i);
+    void* value = chash_get(shared, key);
+    if (value != NULL && value != &values[i])
+      atomic_fetch_add(&bad_reads, 1);
+  }
+  return NULL;
+}
+
+TEST_CASE(threads, {
+  pthread_t writers[WRITERS];
+  pthread_t readers[READERS];
+  char key[16];
+
+  shared = chash_new(0);
+  atomic_store(&writers_done, 0);
+  atomic_store(&bad_reads, 0);
+  for (size_t i = 0; i < READERS; i++)
+    pthread_create(&readers[i], NULL, reader, (void*) (i + 1));
+  for (size_t i = 0; i < WRITERS; i++)
+    pthread_create(&writers[i], NULL, writer, (void*) i);
+  for (size_t i = 0; i < WRITERS; i++)
+    pthread_join(writers[i], NULL);
+  for (size_t i = 0; i < READERS; i++)
+    pthread_join(readers[i], NULL);
+
+  CHECK_EQ_INT(atomic_load(&bad_reads), 0);
+  CHECK_EQ_INT(chash_count(shared), WRITERS * KEYS_PER_WRITER / 2);
+  for (int i = 0; i < WRITERS * KEYS_PER_WRITER; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(chash_get(shared, key) == (i % 2 ? &values[i] : NULL));
+  }
+
+  chash_free(shared);
+})
+
+// Like `reader`, but only for a while, as there are many of them.
+static void* brief_reader(void* arg) {
+  unsigned int seed = (unsigned int) (size_t) arg;
+  char key[16];
+  for (int n = 0; n < 2000; n++) {
+    int i = rand_r(&seed) % KEYS_PER_WRITER;
+    snprintf(key, sizeof(key), "key%d", i);
+    void* value = chash_get(shared, key);
+    if (value != NULL && value != &values[i])
+      atomic_fetch_add(&bad_reads, 1);
+  }
+  return NULL;
+}
+
+// More readers than there are reader slots, twice over, so the second
+// round reuses the slots the first one gave back.
+TEST_CASE(many_readers, {
+  pthread_t readers[CHASH_READERS + 4];
+  pthread_t single;
+
+  for (int round = 0; round < 2; round++) {
+    shared = chash_new(0);
+    atomic_store(&bad_reads, 0);
+    for (size_t i = 0; i < CHASH_READERS + 4; i++)
+      pthread_create(&readers[i], NULL, brief_reader, (void*) (i + 1));
+    pthread_create(&single, NULL, writer, (void*) 0);
+    pthread_join(single, NULL);
+    for (size_t i = 0; i < CHASH_READERS + 4; i++)
+      pthread_join(readers[i], NULL);
+
+    CHECK_EQ_INT(atomic_load(&bad_reads), 0);
+    CHECK_EQ_INT(chash_count(shared), KEYS_PER_WRITER / 2);
+    chash_free(shared);
+  }
+})
+
+MAIN_RUN_TESTS(smoke, resize, threads, many_readers)
@@ -4,9 +4,12 @@
 // clause) to any licence for distributing derivative works that have
 // been produced by the normal use of the Work as a library.
 
+#include <stdio.h>
 #include <string.h>
 #include "mtest.h"
 #include "hash.h"
+// From the library's own internals, to look at the filter by itself.
+#include "hash_private.h"
 
 TEST_CASE(djb2_sanity, {
   // Manually generated hash outside our implementation.
@@ -95,10 +98,852 @@ TEST_CASE(smoke, {
   hash_free(hash);
 })
 
+TEST_CASE(full_table, {
+  hash_t* hash = hash_new(2);
+  int i = 1;
+
+  CHECK_TRUE(hash_put(hash, "Germany", &i) != NULL);
+  CHECK_TRUE(hash_put(hash, "Denmark", &i) != NULL);
+  // A fixed size table refuses new keys once full, but can still update.
+  CHECK_TRUE(hash_put(hash, "Sweden", &i) == NULL);
+  CHECK_TRUE(hash_put(hash, "Germany", &i) != NULL);
+  CHECK_EQ_INT(hash->size, 2);
+
+  hash_free(hash);
+})
+
+TEST_CASE(growable, {
+  hash_t* hash = hash_new_flags(4, HASH_GROWABLE);
+  static int values[1000];
+  char key[16];
+
+  for (int i = 0; i < 1000; i++) {
+    values[i] = i;
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_put(hash, key, &values[i]) == &values[i]);
+  }
+  CHECK_TRUE(hash->size >= 1000);
+  CHECK_EQ_INT(hash_count(hash), 1000);
+
+  for (int i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    int* value = hash_get(hash, key);
+    REQUIRE_TRUE(value != NULL);
+    CHECK_EQ_INT(*value, i);
+  }
+
+  hash_free(hash);
+})
+
+TEST_CASE(incremental_rehash, {
+  hash_t* hash = hash_new_flags(64, HASH_GROWABLE);
+  hash_set_max_load(hash, 0.5);
+  int a = 1, b = 2;
+  char key[16];
+
+  for (int i = 0; i < 32; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    hash_put(hash, key, &a);
+  }
+  CHECK_EQ_INT(hash->size, 64);
+  CHECK_TRUE(hash->draining == NULL);
+
+  // Crossing the max load starts a resize, but moves nothing yet.
+  hash_put(hash, "key32", &a);
+  CHECK_EQ_INT(hash->size, 128);
+  REQUIRE_TRUE(hash->draining != NULL);
+  CHECK_EQ_INT(hash->drain_pos, 0);
+
+  // Keys are reachable, updatable and removable while still draining.
+  // Gets leave the table be, and puts and removes each move a bounded
+  // amount of slots.
+  CHECK_TRUE(hash_get(hash, "key0") == &a);
+  CHECK_EQ_INT(hash->drain_pos, 0);
+  hash_put(hash, "key1", &b);
+  CHECK_TRUE(hash_remove(hash, "key2") == &a);
+  hash_put(hash, "key0", &a);
+  CHECK_EQ_INT(hash->drain_pos, 3 * HASH_REHASH_STEP);
+  CHECK_EQ_INT(hash_count(hash), 32);
+
+  // The fourth write finishes off the draining table.
+  CHECK_TRUE(hash_get(hash, "key1") == &b);
+  CHECK_TRUE(hash->draining != NULL);
+  CHECK_TRUE(hash_remove(hash, "key3") == &a);
+  CHECK_TRUE(hash->draining == NULL);
+  CHECK_TRUE(hash_put(hash, "key3", &a) == &a);
+  CHECK_EQ_INT(hash_count(hash), 32);
+  CHECK_TRUE(hash_get(hash, "key2") == NULL);
+  for (int i = 3; i <= 32; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(hash_get(hash, key) == &a);
+  }
+
+  hash_free(hash);
+})
+
+// With little room between resizes, each write moves more slots over,
+// so the old table is always empty before the next resize starts, and
+// never has to be finished off in one go.
+TEST_CASE(rehash_pacing, {
+  hash_t* hash = hash_new_flags(64, HASH_GROWABLE);
+  hash_set_max_load(hash, 0.05);
+  int a = 1;
+  char key[16];
+
+  unsigned int most_moved = 0;
+  for (int i = 0; i < 2000; i++) {
+    hash_t* old = hash->draining;
+    unsigned int pos = hash->drain_pos;
+    unsigned int old_size = old ? old->size : 0;
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_put(hash, key, &a) == &a);
+
+    if (old == NULL) continue;
+    unsigned int moved = hash->draining == old ? hash->drain_pos - pos : old_size - pos;
+    if (moved > most_moved)
+      most_moved = moved;
+  }
+  // Room for 5% of the doubled table, while the old one drains, makes
+  // about 20 slots a write.
+  CHECK_TRUE(most_moved > HASH_REHASH_STEP);
+  CHECK_TRUE(most_moved <= 2 * HASH_REHASH_STEP);
+  CHECK_EQ_INT(hash_count(hash), 2000);
+  for (int i = 0; i < 2000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(hash_get(hash, key) == &a);
+  }
+
+  hash_free(hash);
+})
+
+TEST_CASE(owned_keys, {
+  // "Aa" and "B@" share the same djb2 hash.
+  REQUIRE_TRUE(djb2_hash("Aa") == djb2_hash("B@"));
+  int a = 1, b = 2;
+
+  // Without owned keys, colliding keys are one and the same.
+  hash_t* hash = hash_new(12);
+  hash_put(hash, "Aa", &a);
+  CHECK_TRUE(hash_get(hash, "B@") == &a);
+  hash_free(hash);
+
+  hash = hash_new_flags(12, HASH_OWN_KEYS);
+  hash_put(hash, "Aa", &a);
+  CHECK_TRUE(hash_get(hash, "B@") == NULL);
+  hash_put(hash, "B@", &b);
+  CHECK_EQ_INT(hash_count(hash), 2);
+  CHECK_TRUE(hash_get(hash, "Aa") == &a);
+  CHECK_TRUE(hash_get(hash, "B@") == &b);
+  CHECK_TRUE(hash_index(hash, "Aa") != hash_index(hash, "B@"));
+
+  CHECK_TRUE(hash_remove(hash, "Aa") == &a);
+  CHECK_TRUE(hash_get(hash, "Aa") == NULL);
+  CHECK_TRUE(hash_get(hash, "B@") == &b);
+
+  hash_free(hash);
+})
+
+TEST_CASE(owned_keys_arena, {
+  hash_t* hash = hash_new_flags(4, HASH_GROWABLE | HASH_OWN_KEYS);
+  int a = 1;
+  char key[16];
+
+  hash_put(hash, "Germany", &a);
+  // Churning through keys should reuse the arena, not grow it forever.
+  for (int i = 0; i < 10000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_put(hash, key, &a) == &a);
+    REQUIRE_TRUE(hash_remove(hash, key) == &a);
+  }
+  CHECK_EQ_INT(hash_count(hash), 1);
+  CHECK_TRUE(hash->arena_cap < 1024);
+  CHECK_TRUE(hash_get(hash, "Germany") == &a);
+
+  hash_free(hash);
+})
+
+TEST_CASE(swiss, {
+  hash_t* hash = hash_new_flags(20, HASH_SWISS | HASH_OWN_KEYS);
+  int a = 1, b = 2;
+
+  // Capacity is rounded up to a power of two.
+  CHECK_EQ_INT(hash->size, 32);
+  CHECK_TRUE(hash_get(hash, "Germany") == NULL);
+
+  hash_put(hash, "Germany", &a);
+  hash_put(hash, "Aa", &a);
+  hash_put(hash, "B@", &b);
+  CHECK_EQ_INT(hash_count(hash), 3);
+  CHECK_TRUE(hash_get(hash, "Germany") == &a);
+  CHECK_TRUE(hash_get(hash, "Aa") == &a);
+  CHECK_TRUE(hash_get(hash, "B@") == &b);
+
+  hash_put(hash, "Germany", &b);
+  CHECK_TRUE(hash_get(hash, "Germany") == &b);
+  CHECK_EQ_INT(hash_count(hash), 3);
+
+  CHECK_TRUE(hash_remove(hash, "Aa") == &a);
+  CHECK_TRUE(hash_get(hash, "Aa") == NULL);
+  CHECK_TRUE(hash_get(hash, "B@") == &b);
+  CHECK_TRUE(hash_remove(hash, "Aa") == NULL);
+  CHECK_EQ_INT(hash_count(hash), 2);
+
+  hash_free(hash);
+})
+
+TEST_CASE(swiss_full, {
+  hash_t* hash = hash_new_flags(16, HASH_SWISS);
+  static int values[17];
+  char key[16];
+
+  // Fill every slot, so probes have to walk all groups.
+  for (int i = 0; i < 16; i++) {
+    values[i] = i;
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_put(hash, key, &values[i]) == &values[i]);
+  }
+  CHECK_TRUE(hash_put(hash, "key16", &values[16]) == NULL);
+  CHECK_TRUE(hash_get(hash, "key16") == NULL);
+
+  // Deleting from a full group leaves a tombstone which gets reused.
+  CHECK_TRUE(hash_remove(hash, "key3") == &values[3]);
+  CHECK_EQ_INT(hash->tombstones, 1);
+  CHECK_TRUE(hash_put(hash, "key16", &values[16]) == &values[16]);
+  CHECK_EQ_INT(hash->tombstones, 0);
+
+  for (int i = 0; i <= 16; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(hash_get(hash, key) == (i == 3 ? NULL : &values[i]));
+  }
+
+  hash_free(hash);
+})
+
+TEST_CASE(swiss_growable, {
+  hash_t* hash = hash_new_flags(0, HASH_SWISS | HASH_GROWABLE | HASH_OWN_KEYS);
+  static int values[5000];
+  char key[16];
+
+  for (int i = 0; i < 5000; i++) {
+    values[i] = i;
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_put(hash, key, &values[i]) == &values[i]);
+  }
+  for (int i = 0; i < 5000; i += 2) {
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_remove(hash, key) == &values[i]);
+  }
+  CHECK_EQ_INT(hash_count(hash), 2500);
+
+  for (int i = 0; i < 5000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(hash_get(hash, key) == (i % 2 ? &values[i] : NULL));
+  }
+  CHECK_EQ_INT(hash->size & (hash->size - 1), 0);
+
+  hash_free(hash);
+})
+
+// Makes every key collide, to test tables with nothing but collisions.
+static unsigned long constant_hash(const char* key, size_t len, unsigned long seed) {
+  (void) key;
+  (void) len;
+  return 42ul + seed;
+}
+
+TEST_CASE(hash_functions, {
+  // The seeded variant of djb2 matches the original with a zero seed.
+  CHECK_TRUE(hash_djb2("Germany", 7, 0) == djb2_hash("Germany"));
+  CHECK_TRUE(hash_djb2("Germany", 7, 1) != djb2_hash("Germany"));
+
+  // Only the given length is hashed.
+  CHECK_TRUE(hash_wy("Germany", 7, 0) == hash_wy("Germany!", 7, 0));
+  CHECK_TRUE(hash_wy("Germany", 7, 0) != hash_wy("Germany", 6, 0));
+  CHECK_TRUE(hash_wy("Germany", 7, 0) != hash_wy("Germany", 7, 1));
+
+  // Every length takes its own path through the hash, check they all
+  // differ from their neighbours and depend on every byte.
+  char key[128];
+  memset(key, 'a', sizeof(key));
+  for (size_t len = 1; len < sizeof(key); len++) {
+    unsigned long hash = hash_wy(key, len, 0);
+    CHECK_TRUE(hash != hash_wy(key, len - 1, 0));
+    key[len - 1] = 'b';
+    CHECK_TRUE(hash != hash_wy(key, len, 0));
+    key[len - 1] = 'a';
+    key[0] = 'b';
+    CHECK_TRUE(hash != hash_wy(key, len, 0));
+    key[0] = 'a';
+  }
+})
+
+TEST_CASE(seeded, {
+  hash_t* first = hash_new_flags(12, HASH_SEEDED);
+  hash_t* second = hash_new_flags(12, HASH_SEEDED);
+  int a = 1;
+
+  CHECK_TRUE(first->hash_func == hash_wy);
+  CHECK_TRUE(first->seed != second->seed);
+
+  hash_put(first, "Germany", &a);
+  CHECK_TRUE(hash_get(first, "Germany") == &a);
+  CHECK_TRUE(hash_remove(first, "Germany") == &a);
+
+  hash_free(first);
+  hash_free(second);
+})
+
+TEST_CASE(custom_hash_function, {
+  hash_t* hash = hash_new_flags(4, HASH_GROWABLE | HASH_OWN_KEYS);
+  static int values[100];
+  char key[16];
+
+  REQUIRE_EQ_INT(hash_set_func(hash, constant_hash, 0), 0);
+  for (int i = 0; i < 100; i++) {
+    values[i] = i;
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_put(hash, key, &values[i]) == &values[i]);
+  }
+  for (int i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(hash_get(hash, key) == &values[i]);
+  }
+
+  // Changing hash function would lose track of the stored keys.
+  CHECK_EQ_INT(hash_set_func(hash, hash_wy, 0), -1);
+
+  hash_free(hash);
+})
+
+TEST_CASE(stats, {
+  hash_t* hash = hash_new_flags(12, HASH_OWN_KEYS);
+  hash_stats_t stats;
+  int a = 1;
+
+  hash_stats(hash, &stats);
+  CHECK_EQ_INT(stats.size, 12);
+  CHECK_EQ_INT(stats.count, 0);
+  CHECK_EQ_DOUBLE(stats.load_factor, 0.0, 0.001);
+  CHECK_EQ_DOUBLE(stats.mean_probe, 0.0, 0.001);
+
+  // "Aa" and "B@" share a hash, so one has to be displaced.
+  hash_put(hash, "Aa", &a);
+  hash_put(hash, "B@", &a);
+  hash_stats(hash, &stats);
+  CHECK_EQ_INT(hash_count(hash), 2);
+  CHECK_EQ_INT(stats.count, 2);
+  CHECK_EQ_INT(stats.displaced, 1);
+  CHECK_EQ_INT(stats.max_probe, 2);
+  CHECK_EQ_DOUBLE(stats.mean_probe, 1.5, 0.001);
+  CHECK_EQ_DOUBLE(stats.load_factor, 2.0 / 12, 0.001);
+
+  // Removing the first moves the second back home.
+  hash_remove(hash, "Aa");
+  hash_stats(hash, &stats);
+  CHECK_EQ_INT(hash_count(hash), 1);
+  CHECK_EQ_INT(stats.displaced, 0);
+  CHECK_EQ_DOUBLE(stats.mean_probe, 1.0, 0.001);
+
+  hash_free(hash);
+})
+
+TEST_CASE(stats_swiss, {
+  hash_t* hash = hash_new_flags(16, HASH_SWISS);
+  hash_stats_t stats;
+  int a = 1;
+  char key[16];
+
+  // A single group can never displace anything.
+  for (int i = 0; i < 16; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    hash_put(hash, key, &a);
+  }
+  hash_remove(hash, "key0");
+  hash_stats(hash, &stats);
+  CHECK_EQ_INT(stats.count, 15);
+  CHECK_EQ_INT(stats.tombstones, 1);
+  CHECK_EQ_INT(stats.displaced, 0);
+  CHECK_EQ_INT(stats.max_probe, 1);
+  CHECK_EQ_DOUBLE(stats.mean_probe, 1.0, 0.001);
+
+  hash_free(hash);
+})
+
+// Sends keys like "11a" to slot 11 of a 12 slot table.
+static unsigned long home_hash(const char* key, size_t len, unsigned long seed) {
+  (void) len;
+  (void) seed;
+  return strtoul(key, NULL, 10) + 12;
+}
+
+TEST_CASE(delete_wrap_around, {
+  hash_t* hash = hash_new_flags(12, HASH_OWN_KEYS);
+  int a = 1;
+  REQUIRE_EQ_INT(hash_set_func(hash, home_hash, 0), 0);
+
+  // A cluster wrapping past the end, with a key from another home in it.
+  hash_put(hash, "11a", &a);
+  hash_put(hash, "11b", &a);
+  hash_put(hash, "0a", &a);
+  hash_put(hash, "11c", &a);
+  CHECK_EQ_INT(hash_index(hash, "11a"), 11);
+  CHECK_EQ_INT(hash_index(hash, "11b"), 0);
+  CHECK_EQ_INT(hash_index(hash, "0a"), 1);
+  CHECK_EQ_INT(hash_index(hash, "11c"), 2);
+
+  // Everything shifts back by one, across the end of the array.
+  CHECK_TRUE(hash_remove(hash, "11a") == &a);
+  CHECK_EQ_INT(hash_index(hash, "11b"), 11);
+  CHECK_EQ_INT(hash_index(hash, "0a"), 0);
+  CHECK_EQ_INT(hash_index(hash, "11c"), 1);
+  CHECK_TRUE(hash->keys[2] == HASH_EMPTY);
+
+  // A key already at home stays put, but ones behind it may still move.
+  CHECK_TRUE(hash_remove(hash, "11b") == &a);
+  CHECK_EQ_INT(hash_index(hash, "0a"), 0);
+  CHECK_EQ_INT(hash_index(hash, "11c"), 11);
+  CHECK_EQ_INT(hash_count(hash), 2);
+
+  hash_free(hash);
+})
+
+TEST_CASE(delete_churn, {
+  hash_t* hash = hash_new_flags(64, HASH_OWN_KEYS);
+  hash_stats_t stats;
+  static int values[20000];
+  char key[16];
+
+  // Keep the table near full while keys come and go.
+  for (int i = 0; i < 20000; i++) {
+    values[i] = i;
+    snprintf(key, sizeof(key), "key%d", i);
+    REQUIRE_TRUE(hash_put(hash, key, &values[i]) == &values[i]);
+    if (i >= 48) {
+      snprintf(key, sizeof(key), "key%d", i - 48);
+      REQUIRE_TRUE(hash_remove(hash, key) == &values[i - 48]);
+    }
+  }
+  CHECK_EQ_INT(hash_count(hash), 48);
+  for (int i = 0; i < 20000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(hash_get(hash, key) == (i >= 20000 - 48 ? &values[i] : NULL));
+  }
+
+  hash_stats(hash, &stats);
+  CHECK_EQ_INT(stats.count, 48);
+  CHECK_EQ_INT(stats.tombstones, 0);
+
+  hash_free(hash);
+})
+
+TEST_CASE(interleaved, {
+  // Every combination of engine and owned keys, as each changes the slots.
+  unsigned int flags[] = {
+    HASH_GROWABLE,
+    HASH_GROWABLE | HASH_OWN_KEYS,
+    HASH_GROWABLE | HASH_SWISS,
+    HASH_GROWABLE | HASH_SWISS | HASH_OWN_KEYS,
+  };
+  static int values[2000];
+  char key[16];
+
+  for (size_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+    hash_t* hash = hash_new_flags(4, flags[f] | HASH_INTERLEAVED);
+    REQUIRE_TRUE(hash != NULL);
+    CHECK_TRUE(hash->key_stride == hash->value_stride);
+    CHECK_TRUE((char*) hash->values - (char*) hash->keys < (long) hash->key_stride);
+
+    for (int i = 0; i < 2000; i++) {
+      values[i] = i;
+      snprintf(key, sizeof(key), "key%d", i);
+      REQUIRE_TRUE(hash_put(hash, key, &values[i]) == &values[i]);
+    }
+    for (int i = 0; i < 2000; i += 2) {
+      snprintf(key, sizeof(key), "key%d", i);
+      REQUIRE_TRUE(hash_remove(hash, key) == &values[i]);
+    }
+    CHECK_EQ_INT(hash_count(hash), 1000);
+    for (int i = 0; i < 2000; i++) {
+      snprintf(key, sizeof(key), "key%d", i);
+      CHECK_TRUE(hash_get(hash, key) == (i % 2 ? &values[i] : NULL));
+    }
+
+    hash_free(hash);
+  }
+
+  // Owned keys are still told apart when their hashes collide.
+  hash_t* hash = hash_new_flags(12, HASH_OWN_KEYS | HASH_INTERLEAVED);
+  int a = 1, b = 2;
+  hash_put(hash, "Aa", &a);
+  hash_put(hash, "B@", &b);
+  CHECK_TRUE(hash_get(hash, "Aa") == &a);
+  CHECK_TRUE(hash_get(hash, "B@") == &b);
+  hash_free(hash);
+})
+
+TEST_CASE(many, {
+  static const unsigned int flags[] = { 0, HASH_GROWABLE | HASH_OWN_KEYS, HASH_SWISS | HASH_GROWABLE };
+  static char key_buf[100][16];
+  static int values[100];
+  const char* keys[100];
+  void* value_ptrs[100];
+  void* found[100];
+
+  for (int i = 0; i < 100; i++) {
+    values[i] = i;
+    value_ptrs[i] = &values[i];
+    snprintf(key_buf[i], sizeof(key_buf[i]), "key%d", i);
+    keys[i] = key_buf[i];
+  }
+
+  for (int f = 0; f < 3; f++) {
+    hash_t* hash = hash_new_flags(flags[f] & HASH_GROWABLE ? 4 : 128, flags[f]);
+
+    // Only store the even keys, to also look up some misses.
+    const char* even_keys[50];
+    void* even_values[50];
+    for (int i = 0; i < 50; i++) {
+      even_keys[i] = keys[2 * i];
+      even_values[i] = value_ptrs[2 * i];
+    }
+    CHECK_EQ_INT(hash_put_many(hash, even_keys, even_values, 50), 50);
+    CHECK_EQ_INT(hash_count(hash), 50);
+
+    hash_get_many(hash, keys, 100, found);
+    for (int i = 0; i < 100; i++) {
+      CHECK_TRUE(found[i] == (i % 2 ? NULL : &values[i]));
+      CHECK_TRUE(found[i] == hash_get(hash, keys[i]));
+    }
+
+    hash_free(hash);
+  }
+
+  // A full table stores what it has room for.
+  hash_t* hash = hash_new(10);
+  CHECK_EQ_INT(hash_put_many(hash, keys, value_ptrs, 100), 10);
+  hash_free(hash);
+})
+
+// Saves strings as their bytes, terminator included.
+static const void* _encode_string(const void* value, size_t* len, void* ctx) {
+  *len = strlen(value) + 1;
+  *(int*) ctx += 1;
+  return value;
+}
+
+TEST_CASE(snapshot, {
+  const char* path = "test_hash_snapshot.bin";
+  unsigned int flags[] = {
+    0,
+    HASH_OWN_KEYS,
+    HASH_SWISS | HASH_OWN_KEYS,
+    HASH_INTERLEAVED,
+    HASH_INTERLEAVED | HASH_OWN_KEYS | HASH_SWISS,
+    HASH_GROWABLE | HASH_OWN_KEYS | HASH_SEEDED,
+    HASH_OWN_KEYS | HASH_FILTER,
+  };
+  char keys[200][16];
+  char values[200][16];
+  for (int i = 0; i < 200; i++) {
+    snprintf(keys[i], sizeof(keys[i]), "key%d", i);
+    snprintf(values[i], sizeof(values[i]), "value%d", i);
+  }
+
+  for (int f = 0; f < 7; f++) {
+    hash_t* hash = hash_new_flags(flags[f] & HASH_GROWABLE ? 4 : 256, flags[f]);
+    // Store the even keys, and remove some again to leave holes behind.
+    for (int i = 0; i < 100; i++)
+      REQUIRE_TRUE(hash_put(hash, keys[2 * i], values[2 * i]) != NULL);
+    for (int i = 0; i < 100; i += 10)
+      REQUIRE_TRUE(hash_remove(hash, keys[2 * i]) != NULL);
+
+    int encoded = 0;
+    REQUIRE_EQ_INT(hash_save(hash, path, _encode_string, &encoded), 0);
+    CHECK_EQ_INT(encoded, 90);
+    hash_t* loaded = hash_load(path);
+    REQUIRE_TRUE(loaded != NULL);
+    CHECK_EQ_INT(hash_count(loaded), 90);
+    CHECK_EQ_INT(loaded->size, hash->size);
+
+    for (int i = 0; i < 200; i++) {
+      const char* value = hash_get(loaded, keys[i]);
+      if (i % 2 == 0 && i % 20 != 0) {
+        // Values come back as their bytes, out of the mapping.
+        REQUIRE_TRUE(value != NULL);
+        CHECK_TRUE(strcmp(value, values[i]) == 0);
+        CHECK_TRUE(value != values[i]);
+        CHECK_EQ_INT(hash_index(loaded, keys[i]), hash_index(hash, keys[i]));
+      } else {
+        CHECK_TRUE(value == NULL);
+      }
+    }
+    const char* many_keys[] = { keys[2], keys[3], keys[198] };
+    void* found[3];
+    hash_get_many(loaded, many_keys, 3, found);
+    CHECK_TRUE(found[0] && strcmp(found[0], values[2]) == 0);
+    CHECK_TRUE(found[1] == NULL);
+    CHECK_TRUE(found[2] && strcmp(found[2], values[198]) == 0);
+
+    hash_stats_t stats, loaded_stats;
+    hash_stats(hash, &stats);
+    hash_stats(loaded, &loaded_stats);
+    CHECK_EQ_INT(loaded_stats.count, stats.count);
+    CHECK_EQ_INT(loaded_stats.max_probe, stats.max_probe);
+    CHECK_EQ_DOUBLE(loaded_stats.mean_probe, stats.mean_probe, 0.0001);
+
+    // A loaded table is read-only.
+    CHECK_TRUE(hash_put(loaded, keys[1], values[1]) == NULL);
+    CHECK_TRUE(hash_remove(loaded, keys[2]) == NULL);
+    CHECK_EQ_INT(hash_count(loaded), 90);
+
+    hash_free(loaded);
+    hash_free(hash);
+  }
+  remove(path);
+})
+
+TEST_CASE(snapshot_plain_values, {
+  const char* path = "test_hash_snapshot.bin";
+  hash_t* hash = hash_new_flags(64, HASH_OWN_KEYS);
+  char key[16];
+  for (long i = 1; i <= 20; i++) {
+    snprintf(key, sizeof(key), "%ld", i);
+    hash_put(hash, key, (void*) i);
+  }
+
+  // Without an encoder, values are saved as they are.
+  REQUIRE_EQ_INT(hash_save(hash, path, NULL, NULL), 0);
+  hash_t* loaded = hash_load(path);
+  REQUIRE_TRUE(loaded != NULL);
+  for (long i = 1; i <= 20; i++) {
+    snprintf(key, sizeof(key), "%ld", i);
+    CHECK_TRUE(hash_get(loaded, key) == (void*) i);
+  }
+  CHECK_TRUE(hash_get(loaded, "21") == NULL);
+  hash_free(loaded);
+
+  // Snapshots need a hash function they can name.
+  hash_t* custom = hash_new(16);
+  REQUIRE_EQ_INT(hash_set_func(custom, constant_hash, 0), 0);
+  CHECK_EQ_INT(hash_save(custom, path, NULL, NULL), -1);
+  hash_free(custom);
+
+  // Anything but a snapshot is refused.
+  FILE* file = fopen(path, "wb");
+  REQUIRE_TRUE(file != NULL);
+  for (int i = 0; i < 100; i++)
+    fputs("not a snapshot ", file);
+  fclose(file);
+  CHECK_TRUE(hash_load(path) == NULL);
+  CHECK_TRUE(hash_load("does/not/exist") == NULL);
+
+  remove(path);
+  hash_free(hash);
+})
+
+static const void* _encode_nothing(const void* value, size_t* len, void* ctx) {
+  (void) value;
+  (void) len;
+  (void) ctx;
+  return NULL;
+}
+
+TEST_CASE(snapshot_replace, {
+  const char* path = "test_hash_snapshot_replace.bin";
+  hash_t* first = hash_new_flags(64, HASH_OWN_KEYS);
+  hash_t* second = hash_new_flags(1024, HASH_OWN_KEYS | HASH_SWISS);
+  hash_put(first, "Germany", (void*) 1);
+  hash_put(second, "Denmark", (void*) 2);
+
+  REQUIRE_EQ_INT(hash_save(first, path, NULL, NULL), 0);
+  hash_t* old = hash_load(path);
+  REQUIRE_TRUE(old != NULL);
+
+  // Saving over a snapshot in use leaves the mapping of the old one be.
+  REQUIRE_EQ_INT(hash_save(second, path, NULL, NULL), 0);
+  CHECK_TRUE(hash_get(old, "Germany") == (void*) 1);
+  hash_t* new = hash_load(path);
+  REQUIRE_TRUE(new != NULL);
+  CHECK_TRUE(hash_get(new, "Denmark") == (void*) 2);
+  CHECK_TRUE(hash_get(new, "Germany") == NULL);
+
+  // A failed save keeps what was there.
+  CHECK_EQ_INT(hash_save(first, path, _encode_nothing, NULL), -1);
+  hash_t* kept = hash_load(path);
+  REQUIRE_TRUE(kept != NULL);
+  CHECK_TRUE(hash_get(kept, "Denmark") == (void*) 2);
+
+  hash_free(kept);
+  hash_free(new);
+  hash_free(old);
+  hash_free(second);
+  hash_free(first);
+  remove(path);
+})
+
+TEST_CASE(build, {
+  enum { COUNT = 40000 };
+  unsigned int flags[] = {
+    0,
+    HASH_OWN_KEYS,
+    HASH_SWISS | HASH_OWN_KEYS,
+    HASH_INTERLEAVED | HASH_OWN_KEYS,
+    HASH_GROWABLE | HASH_OWN_KEYS | HASH_SEEDED,
+    HASH_SWISS | HASH_OWN_KEYS | HASH_FILTER,
+  };
+  static char key_buf[COUNT][16];
+  static const char* keys[COUNT];
+  static void* values[COUNT];
+  static int numbers[COUNT];
+  for (int i = 0; i < COUNT; i++) {
+    // Every tenth key is given twice, the second time with a new value.
+    int key = i % 10 == 9 ? i - 5 : i;
+    snprintf(key_buf[i], sizeof(key_buf[i]), "key%d", key);
+    keys[i] = key_buf[i];
+    numbers[i] = i;
+    values[i] = &numbers[i];
+  }
+
+  for (int f = 0; f < 6; f++) {
+    for (unsigned int threads = 1; threads <= 4; threads += 3) {
+      hash_t* built = hash_build(keys, values, COUNT, flags[f], threads);
+      REQUIRE_TRUE(built != NULL);
+      hash_t* put = hash_new_flags(built->size, flags[f]);
+      if (flags[f] & HASH_SEEDED)
+        REQUIRE_EQ_INT(hash_set_func(put, built->hash_func, built->seed), 0);
+      CHECK_EQ_INT(hash_put_many(put, keys, values, COUNT), COUNT);
+
+      // Holds the same as putting the keys one by one.
+      CHECK_EQ_INT(hash_count(built), COUNT / 10 * 9);
+      CHECK_EQ_INT(hash_count(built), hash_count(put));
+      int same = 1;
+      for (int i = 0; i < COUNT; i++)
+        same &= hash_get(built, keys[i]) == hash_get(put, keys[i]);
+      CHECK_TRUE(same);
+      CHECK_TRUE(hash_get(built, "key9") == NULL);
+      CHECK_TRUE(hash_get(built, "key4") == &numbers[9]);
+
+      hash_stats_t stats;
+      hash_stats(built, &stats);
+      CHECK_EQ_INT(stats.count, COUNT / 10 * 9);
+      CHECK_TRUE(stats.load_factor <= HASH_DEFAULT_MAX_LOAD);
+      if (flags[f] & HASH_OWN_KEYS)
+        CHECK_TRUE(built->arena_garbage > 0);
+
+      // And keeps working as any other table.
+      CHECK_TRUE(hash_remove(built, "key4") == &numbers[9]);
+      CHECK_TRUE(hash_put(built, "key4", &numbers[0]) == &numbers[0]);
+      CHECK_TRUE(hash_get(built, "key4") == &numbers[0]);
+
+      hash_free(put);
+      hash_free(built);
+    }
+  }
+
+  // Small and empty builds.
+  hash_t* small = hash_build(keys, values, 3, HASH_OWN_KEYS, 0);
+  REQUIRE_TRUE(small != NULL);
+  CHECK_EQ_INT(hash_count(small), 3);
+  CHECK_TRUE(hash_get(small, "key2") == &numbers[2]);
+  hash_free(small);
+  hash_t* empty = hash_build(keys, values, 0, HASH_GROWABLE, 0);
+  REQUIRE_TRUE(empty != NULL);
+  CHECK_EQ_INT(hash_count(empty), 0);
+  CHECK_TRUE(hash_put(empty, "key", &numbers[0]) != NULL);
+  hash_free(empty);
+})
+
+static int _hash_filter_passes(const hash_t* hash_table, const char* key) {
+  return _hash_filter_may_have(hash_table, _hash_key(hash_table, key, strlen(key)));
+}
+
+TEST_CASE(filter, {
+  enum { COUNT = 5000 };
+  unsigned int flags[] = {
+    HASH_OWN_KEYS,
+    HASH_SWISS | HASH_OWN_KEYS,
+    HASH_GROWABLE | HASH_OWN_KEYS,
+    HASH_GROWABLE | HASH_SWISS | HASH_INTERLEAVED,
+  };
+  static char keys[2 * COUNT][16];
+  static int values[COUNT];
+  for (int i = 0; i < 2 * COUNT; i++)
+    snprintf(keys[i], sizeof(keys[i]), "key%d", i);
+
+  for (int f = 0; f < 4; f++) {
+    unsigned int size = flags[f] & HASH_GROWABLE ? 4 : 2 * COUNT;
+    hash_t* filtered = hash_new_flags(size, flags[f] | HASH_FILTER);
+    hash_t* plain = hash_new_flags(size, flags[f]);
+    REQUIRE_TRUE(filtered != NULL && filtered->filter != NULL);
+    for (int i = 0; i < COUNT; i++) {
+      values[i] = i;
+      REQUIRE_TRUE(hash_put(filtered, keys[i], &values[i]) != NULL);
+      REQUIRE_TRUE(hash_put(plain, keys[i], &values[i]) != NULL);
+    }
+
+    // Lookups agree with an unfiltered table, for keys there or not.
+    int same = 1;
+    for (int i = 0; i < 2 * COUNT; i++)
+      same &= hash_get(filtered, keys[i]) == hash_get(plain, keys[i]);
+    CHECK_TRUE(same);
+
+    // Removing most keys rebuilds the filter on the way, without ever
+    // losing one still there.
+    for (int i = 0; i < COUNT; i++)
+      if (i % 4 != 0) {
+        REQUIRE_TRUE(hash_remove(filtered, keys[i]) == &values[i]);
+        REQUIRE_TRUE(hash_remove(plain, keys[i]) == &values[i]);
+      }
+    CHECK_TRUE(filtered->filter_stale <= filtered->size / 8);
+    same = 1;
+    for (int i = 0; i < 2 * COUNT; i++)
+      same &= hash_get(filtered, keys[i]) == hash_get(plain, keys[i]);
+    CHECK_TRUE(same);
+    CHECK_EQ_INT(hash_count(filtered), hash_count(plain));
+
+    hash_free(plain);
+    hash_free(filtered);
+  }
+
+  // Few keys never put get past the filter.
+  hash_t* hash = hash_new_flags(2 * COUNT, HASH_FILTER);
+  for (int i = 0; i < COUNT; i++)
+    REQUIRE_TRUE(hash_put(hash, keys[i], &values[i]) != NULL);
+  int passed = 0;
+  for (int i = COUNT; i < 2 * COUNT; i++)
+    passed += _hash_filter_passes(hash, keys[i]);
+  CHECK_TRUE(passed < COUNT / 100);
+  for (int i = 0; i < COUNT; i++)
+    REQUIRE_TRUE(_hash_filter_passes(hash, keys[i]));
+  hash_free(hash);
+})
+
 MAIN_RUN_TESTS(djb2_sanity,
                creation,
                indexing,
                linear_probing,
                delete,
                delete_linear_probing,
-               smoke)
+               smoke,
+               full_table,
+               growable,
+               incremental_rehash, rehash_pacing,
+               owned_keys,
+               owned_keys_arena,
+               swiss,
+               swiss_full,
+               swiss_growable,
+               hash_functions,
+               seeded,
+               custom_hash_function,
+               stats,
+               stats_swiss,
+               delete_wrap_around,
+               delete_churn,
+               interleaved,
+               many,
+               snapshot,
+               snapshot_plain_values,
+               snapshot_replace,
+               build,
+               filter)
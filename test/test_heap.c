@@ -0,0 +1,189 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include "mtest.h"
+#include "item.h"
+#include "heap.h"
+
+static item_t _int(int i) {
+  return (item_t) { .type = 'i', .data.i = i };
+}
+
+static int _descending(item_t left, item_t right) {
+  return item_compare(right, left);
+}
+
+TEST_CASE(create_and_free, {
+  heap_t* heap = heap_new(0, NULL);
+
+  REQUIRE_TRUE(heap != NULL);
+  CHECK_TRUE(heap->items == NULL);
+  CHECK_TRUE(heap_empty(heap) != 0);
+  CHECK_EQ_INT(heap_length(heap), 0);
+  CHECK_TRUE(heap_peek(heap) == NULL);
+  CHECK_TRUE(item_equal(heap_pop(heap), ITEM_NULL));
+  heap_free(heap);
+
+  heap = heap_new(100, NULL);
+  REQUIRE_TRUE(heap != NULL);
+  CHECK_EQ_INT(heap->capacity, 100);
+  heap_free(heap);
+})
+
+TEST_CASE(push_pop, {
+  heap_t* heap = heap_new(0, NULL);
+  srand(42);
+
+  for (int i = 0; i < 1000; i++)
+    REQUIRE_TRUE(heap_push(heap, _int(rand() % 500)) != HEAP_NO_HANDLE);
+  CHECK_EQ_INT(heap_length(heap), 1000);
+
+  // Comes out in order, with the smallest always on top.
+  int last = -1;
+  int ordered = 1;
+  while (!heap_empty(heap)) {
+    int top = heap_peek(heap)->data.i;
+    int popped = heap_pop(heap).data.i;
+    ordered &= top == popped && popped >= last;
+    last = popped;
+  }
+  CHECK_TRUE(ordered);
+
+  // Or the largest, with the comparator turned around.
+  heap_t* max = heap_new(0, _descending);
+  for (int i = 0; i < 10; i++)
+    heap_push(max, _int(i));
+  CHECK_EQ_INT(heap_pop(max).data.i, 9);
+  CHECK_EQ_INT(heap_pop(max).data.i, 8);
+
+  heap_free(max);
+  heap_free(heap);
+})
+
+TEST_CASE(from_array, {
+  item_t items[1000];
+  for (int i = 0; i < 1000; i++)
+    items[i] = _int((i * 7919) % 1000);
+  heap_t* heap = heap_from_array(items, 1000, NULL);
+  REQUIRE_TRUE(heap != NULL);
+  CHECK_EQ_INT(heap_length(heap), 1000);
+
+  // The handle of each item is its position in the array.
+  CHECK_EQ_INT(heap_get(heap, 1)->data.i, 919);
+  CHECK_EQ_INT(heap_get(heap, 999)->data.i, (999 * 7919) % 1000);
+  CHECK_TRUE(heap_get(heap, 1000) == NULL);
+
+  int ordered = 1;
+  for (int i = 0; i < 1000; i++)
+    ordered &= heap_pop(heap).data.i == i;
+  CHECK_TRUE(ordered);
+  heap_free(heap);
+
+  heap = heap_from_array(items, 1, NULL);
+  CHECK_EQ_INT(heap_pop(heap).data.i, 0);
+  heap_free(heap);
+  heap = heap_from_array(items, 0, NULL);
+  CHECK_TRUE(heap_empty(heap) != 0);
+  heap_free(heap);
+})
+
+TEST_CASE(handles, {
+  heap_t* heap = heap_new(0, NULL);
+
+  heap_handle_t a = heap_push(heap, _int(50));
+  heap_handle_t b = heap_push(heap, _int(40));
+  heap_handle_t c = heap_push(heap, _int(60));
+  CHECK_EQ_INT(heap_peek(heap)->data.i, 40);
+
+  // Decreasing a key moves it up, and increasing one moves it down.
+  REQUIRE_EQ_INT(heap_update(heap, c, _int(10)), 0);
+  CHECK_EQ_INT(heap_peek(heap)->data.i, 10);
+  REQUIRE_EQ_INT(heap_update(heap, c, _int(70)), 0);
+  CHECK_EQ_INT(heap_peek(heap)->data.i, 40);
+  CHECK_EQ_INT(heap_get(heap, c)->data.i, 70);
+
+  CHECK_EQ_INT(heap_remove(heap, a).data.i, 50);
+  CHECK_TRUE(heap_get(heap, a) == NULL);
+  CHECK_EQ_INT(heap_update(heap, a, _int(0)), -1);
+  CHECK_TRUE(item_equal(heap_remove(heap, a), ITEM_NULL));
+
+  // The slot of a handle is given out again once free, but the old
+  // handle does not find the new item.
+  heap_handle_t d = heap_push(heap, _int(45));
+  CHECK_EQ_INT((unsigned int) d, (unsigned int) a);
+  CHECK_TRUE(d != a);
+  CHECK_TRUE(heap_get(heap, a) == NULL);
+  CHECK_EQ_INT(heap_update(heap, a, _int(0)), -1);
+  CHECK_TRUE(item_equal(heap_remove(heap, a), ITEM_NULL));
+  CHECK_EQ_INT(heap_get(heap, d)->data.i, 45);
+  CHECK_EQ_INT(heap_pop(heap).data.i, 40);
+  CHECK_TRUE(heap_get(heap, b) == NULL);
+  CHECK_EQ_INT(heap_pop(heap).data.i, 45);
+  CHECK_EQ_INT(heap_pop(heap).data.i, 70);
+
+  heap_free(heap);
+})
+
+// Mirrors random pushes, pops, updates and removes in a plain array of
+// values by handle.
+TEST_CASE(random_ops, {
+  enum { HANDLES = 2000 };
+  heap_t* heap = heap_new(0, NULL);
+  static int values[HANDLES];
+  static int live[HANDLES];
+  static heap_handle_t handles[HANDLES];
+  int length = 0;
+  srand(42);
+
+  for (int step = 0; step < 50000; step++) {
+    int op = rand() % 4;
+    if (length == 0 || (op == 0 && length < HANDLES)) {
+      int value = rand() % 10000;
+      heap_handle_t pushed = heap_push(heap, _int(value));
+      unsigned int handle = (unsigned int) pushed;
+      REQUIRE_TRUE(handle < HANDLES && !live[handle]);
+      // A stale handle to the same slot finds nothing.
+      if (handles[handle])
+        REQUIRE_TRUE(heap_get(heap, handles[handle]) == NULL);
+      handles[handle] = pushed;
+      values[handle] = value;
+      live[handle] = 1;
+      length += 1;
+      continue;
+    }
+    // Any handle in use, by walking from a random one.
+    int handle = rand() % HANDLES;
+    while (!live[handle])
+      handle = (handle + 1) % HANDLES;
+
+    if (op == 1) {
+      int least = -1;
+      for (int h = 0; h < HANDLES; h++)
+        if (live[h] && (least == -1 || values[h] < values[least])) least = h;
+      REQUIRE_EQ_INT(heap_pop(heap).data.i, values[least]);
+      live[least] = 0;
+      length -= 1;
+    } else if (op == 2) {
+      values[handle] = rand() % 10000;
+      REQUIRE_EQ_INT(heap_update(heap, handles[handle], _int(values[handle])), 0);
+    } else {
+      REQUIRE_EQ_INT(heap_remove(heap, handles[handle]).data.i, values[handle]);
+      live[handle] = 0;
+      length -= 1;
+    }
+    REQUIRE_EQ_INT(heap_length(heap), length);
+  }
+
+  int consistent = 1;
+  for (int h = 0; h < HANDLES; h++)
+    if (live[h])
+      consistent &= heap_get(heap, handles[h])->data.i == values[h];
+  CHECK_TRUE(consistent);
+  heap_free(heap);
+})
+
+MAIN_RUN_TESTS(create_and_free, push_pop, from_array, handles, random_ops)
@@ -0,0 +1,146 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include <string.h>
+#include "mtest.h"
+#include "item.h"
+#include "ilist.h"
+
+TEST_CASE(create_and_free, {
+  ilist_t* list = ilist_new();
+
+  REQUIRE_TRUE(list != NULL);
+  CHECK_TRUE(list->head->links[0].next == NULL);
+  CHECK_TRUE(ilist_empty(list) != 0);
+  CHECK_EQ_INT(ilist_length(list), 0);
+
+  ilist_free(list);
+})
+
+TEST_CASE(prepend_append, {
+  ilist_t* list = ilist_new();
+
+  ilist_prepend(list, (item_t) { .type = 'i', .data.i = 42 });
+  ilist_prepend(list, (item_t) { .type = 'i', .data.i = 69 });
+  ilist_append(list, (item_t) { .type = 'i', .data.i = 21 });
+
+  CHECK_EQ_INT(ilist_length(list), 3);
+  CHECK_EQ_INT(ilist_at(list, 0)->data.i, 69);
+  CHECK_EQ_INT(ilist_at(list, 1)->data.i, 42);
+  CHECK_EQ_INT(ilist_at(list, 2)->data.i, 21);
+
+  ilist_free(list);
+})
+
+TEST_CASE(indexing, {
+  ilist_t* list = ilist_new();
+  for (int i = 0; i < 1000; i++)
+    REQUIRE_TRUE(ilist_append(list, (item_t) { .type = 'i', .data.i = i }) != NULL);
+
+  for (int i = 0; i < 1000; i++) {
+    CHECK_EQ_INT(ilist_at(list, i)->data.i, i);
+    CHECK_EQ_INT(ilist_at(list, -1 - i)->data.i, 999 - i);
+  }
+  // Higher levels are in use, or this would be a plain list.
+  CHECK_TRUE(list->level > 1);
+
+  // Out of bounds.
+  CHECK_TRUE(ilist_at(list, 1000) == NULL);
+  CHECK_TRUE(ilist_at(list, -1001) == NULL);
+  CHECK_TRUE(ilist_at(list, 100000000) == NULL);
+  CHECK_TRUE(ilist_insert(list, 1001, ITEM_NULL) == NULL);
+
+  ilist_free(list);
+})
+
+TEST_CASE(delete, {
+  ilist_t* list = ilist_new();
+
+  item_t first = { .type = 'i', .data.i = 69 };
+  item_t second = { .type = 'i', .data.i = 42 };
+  item_t third = { .type = 'i', .data.i = 21 };
+  ilist_append(list, first);
+  ilist_append(list, second);
+  ilist_append(list, third);
+
+  CHECK_TRUE(item_equal(ilist_remove(list, 1), second));
+  CHECK_TRUE(item_equal(ilist_remove(list, -1), third));
+  CHECK_TRUE(item_equal(ilist_remove(list, 0), first));
+  CHECK_TRUE(ilist_empty(list) != 0);
+  CHECK_EQ_INT(list->level, 0);
+
+  // Ensure we do not delete out of bounds and instead return ITEM_NULL.
+  CHECK_TRUE(item_equal(ilist_remove(list, 0), ITEM_NULL));
+
+  ilist_free(list);
+})
+
+TEST_CASE(find, {
+  ilist_t* list = ilist_new();
+
+  for (int i = 0; i < 50; i++)
+    ilist_append(list, (item_t) { .type = 'i', .data.i = i });
+  ilist_append(list, (item_t) { .type = 'S', .data.S = "Germany" });
+
+  CHECK_EQ_INT(ilist_find(list, (item_t) { .type = 'i', .data.i = 0 }), 0);
+  CHECK_EQ_INT(ilist_find(list, (item_t) { .type = 'i', .data.i = 37 }), 37);
+  CHECK_EQ_INT(ilist_find(list, (item_t) { .type = 'S', .data.S = "Germany" }), 50);
+  CHECK_EQ_INT(ilist_find(list, (item_t) { .type = 'i', .data.i = 50 }), -1);
+
+  ilist_free(list);
+})
+
+// Mirrors random inserts and removes in a plain array, checking every
+// link width along the way.
+TEST_CASE(random_ops, {
+  ilist_t* list = ilist_new();
+  static int expected[2000];
+  int length = 0;
+  srand(42);
+
+  for (int step = 0; step < 20000; step++) {
+    if (length < 2000 && (length == 0 || rand() % 3 != 0)) {
+      int pos = rand() % (length + 1);
+      int value = rand();
+      REQUIRE_TRUE(ilist_insert(list, pos, (item_t) { .type = 'i', .data.i = value }) != NULL);
+      memmove(expected + pos + 1, expected + pos, (length - pos) * sizeof(int));
+      expected[pos] = value;
+      length += 1;
+    } else {
+      int pos = rand() % length;
+      REQUIRE_EQ_INT(ilist_remove(list, pos).data.i, expected[pos]);
+      memmove(expected + pos, expected + pos + 1, (length - pos - 1) * sizeof(int));
+      length -= 1;
+    }
+    int probe = rand() % (length + 1);
+    if (probe < length)
+      REQUIRE_EQ_INT(ilist_at(list, probe)->data.i, expected[probe]);
+  }
+
+  REQUIRE_EQ_INT(ilist_length(list), length);
+  for (unsigned int l = 0; l < list->level; l++) {
+    // Each link skips exactly the positions between its two nodes.
+    unsigned int pos = 0;
+    inode_t* node = list->head;
+    while (node) {
+      unsigned int steps = 0;
+      inode_t* at = node;
+      do {
+        at = at->links[0].next;
+        steps += 1;
+      } while (at != node->links[l].next);
+      CHECK_EQ_INT(node->links[l].width, steps);
+      pos += steps;
+      node = node->links[l].next;
+    }
+    CHECK_EQ_INT(pos, length + 1);
+  }
+
+  ilist_free(list);
+})
+
+MAIN_RUN_TESTS(create_and_free, prepend_append, indexing, delete, find, random_ops)
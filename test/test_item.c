@@ -4,6 +4,8 @@
 // clause) to any licence for distributing derivative works that have
 // been produced by the normal use of the Work as a library.
 
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "mtest.h"
@@ -40,4 +42,175 @@ TEST_CASE(strings, {
   free(d_str);
 })
 
-MAIN_RUN_TESTS(strings)
+TEST_CASE(cached_strings, {
+  item_t cached = item_str("Test");
+  item_t other = item_str("Test");
+  REQUIRE_TRUE(cached.type == 'h');
+  CHECK_EQ_INT(cached.data.h->len, 4);
+  CHECK_TRUE(strcmp(cached.data.h->str, "Test") == 0);
+
+  CHECK_TRUE(item_equal(cached, other));
+  CHECK_TRUE(item_equal(cached, (item_t) { .type = 'S', .data.S = "Test" }));
+  CHECK_TRUE(item_equal((item_t) { .type = 'S', .data.S = "Test" }, cached));
+  CHECK_FALSE(item_equal(cached, (item_t) { .type = 'S', .data.S = "Tes" }));
+  item_free(other);
+
+  // Same length and hash is not enough, the bytes have to match too.
+  other = item_str("tseT");
+  other.data.h->hash = cached.data.h->hash;
+  CHECK_FALSE(item_equal(cached, other));
+
+  item_free(cached);
+  item_free(other);
+})
+
+TEST_CASE(hashing, {
+  item_t cached = item_str("Test");
+
+  // Equal items hash the same, whatever kind of string they are.
+  CHECK_TRUE(item_hash(cached) == item_hash((item_t) { .type = 'S', .data.S = "Test" }));
+  CHECK_TRUE(item_hash(cached) != item_hash((item_t) { .type = 'S', .data.S = "tseT" }));
+  CHECK_TRUE(item_hash((item_t) { .type = 'd', .data.d = 0.0 })
+             == item_hash((item_t) { .type = 'd', .data.d = -0.0 }));
+
+  // Small values are spread out over the hash.
+  unsigned long one = item_hash((item_t) { .type = 'i', .data.i = 1 });
+  unsigned long two = item_hash((item_t) { .type = 'i', .data.i = 2 });
+  CHECK_TRUE(one != two);
+  CHECK_TRUE((one >> 32) != (two >> 32));
+
+  item_free(cached);
+})
+
+TEST_CASE(inline_strings, {
+  item_t short_string = item_string("Germany");
+  item_t longest = item_string("Liechtenstein!");
+  item_t too_long = item_string("Bosnia and Herzegovina");
+
+  // Only strings that do not fit are allocated.
+  CHECK_TRUE(short_string.type == 'q');
+  CHECK_TRUE(longest.type == 'q');
+  CHECK_TRUE(too_long.type == 's');
+  CHECK_TRUE(strcmp(item_cstr(&short_string), "Germany") == 0);
+  CHECK_TRUE(strcmp(item_cstr(&longest), "Liechtenstein!") == 0);
+  CHECK_TRUE(strcmp(item_cstr(&too_long), "Bosnia and Herzegovina") == 0);
+  CHECK_TRUE(item_cstr(&(item_t) { .type = 'i', .data.i = 42 }) == NULL);
+
+  item_t other = item_string("Germany");
+  CHECK_TRUE(item_equal(short_string, other));
+  CHECK_FALSE(item_equal(short_string, longest));
+  CHECK_TRUE(item_equal(short_string, (item_t) { .type = 'S', .data.S = "Germany" }));
+  CHECK_TRUE(item_equal((item_t) { .type = 'S', .data.S = "Germany" }, short_string));
+  CHECK_FALSE(item_equal(short_string, (item_t) { .type = 'S', .data.S = "German" }));
+  CHECK_TRUE(item_equal(too_long, (item_t) { .type = 'S', .data.S = "Bosnia and Herzegovina" }));
+
+  item_t cached = item_str("Germany");
+  CHECK_TRUE(item_equal(short_string, cached));
+  CHECK_TRUE(item_hash(short_string) == item_hash(cached));
+
+  item_free(short_string);
+  item_free(longest);
+  item_free(too_long);
+  item_free(other);
+  item_free(cached);
+})
+
+TEST_CASE(compare, {
+  item_t one = { .type = 'i', .data.i = 1 };
+  item_t two = { .type = 'i', .data.i = 2 };
+  CHECK_TRUE(item_compare(one, two) < 0);
+  CHECK_TRUE(item_compare(two, one) > 0);
+  CHECK_EQ_INT(item_compare(one, one), 0);
+
+  // Strings of any kind compare with each other.
+  item_t cached = item_str("Denmark");
+  CHECK_EQ_INT(item_compare(cached, (item_t) { .type = 'S', .data.S = "Denmark" }), 0);
+  CHECK_TRUE(item_compare(cached, item_string("Norway")) < 0);
+
+  // As in `item_equal`, -0.0 is 0.0, and NaN goes after anything else.
+  CHECK_EQ_INT(item_compare((item_t) { .type = 'd', .data.d = -0.0 }, (item_t) { .type = 'd', .data.d = 0.0 }), 0);
+  CHECK_TRUE(item_compare((item_t) { .type = 'd', .data.d = NAN }, (item_t) { .type = 'd', .data.d = INFINITY }) > 0);
+  CHECK_EQ_INT(item_compare((item_t) { .type = 'd', .data.d = NAN }, (item_t) { .type = 'd', .data.d = NAN }), 0);
+
+  // Different kinds are kept apart.
+  CHECK_TRUE(item_compare(one, cached) != 0);
+  CHECK_TRUE(item_compare(one, cached) == -item_compare(cached, one));
+
+  item_free(cached);
+})
+
+// Sorts by `item_compare`, and checks the order against it.
+static int _sorted(const item_t* items, size_t count, item_cmp_t cmp) {
+  for (size_t i = 1; i < count; i++)
+    if (cmp(items[i - 1], items[i]) > 0) return 0;
+  return 1;
+}
+
+static int _descending(item_t left, item_t right) {
+  return item_compare(right, left);
+}
+
+TEST_CASE(sort, {
+  enum { COUNT = 5000 };
+  item_t* items = malloc(COUNT * sizeof(item_t));
+  REQUIRE_TRUE(items != NULL);
+  srand(42);
+
+  // Ints, radix sorted, including negatives and the extremes.
+  for (int i = 0; i < COUNT; i++)
+    items[i] = (item_t) { .type = 'i', .data.i = rand() - RAND_MAX / 2 };
+  items[7].data.i = -2147483647 - 1;
+  items[8].data.i = 2147483647;
+  long long sum = 0;
+  for (int i = 0; i < COUNT; i++)
+    sum += items[i].data.i;
+  item_sort(items, COUNT, NULL);
+  CHECK_TRUE(_sorted(items, COUNT, item_compare));
+  CHECK_EQ_INT(items[0].data.i, -2147483647 - 1);
+  CHECK_EQ_INT(items[COUNT - 1].data.i, 2147483647);
+  long long after = 0;
+  for (int i = 0; i < COUNT; i++)
+    after += items[i].data.i;
+  CHECK_TRUE(sum == after);
+
+  // Doubles, radix sorted, with signed zeros, infinities and NaN.
+  for (int i = 0; i < COUNT; i++)
+    items[i] = (item_t) { .type = 'd', .data.d = (rand() - RAND_MAX / 2) / 1000.0 };
+  items[0].data.d = NAN;
+  items[1].data.d = -INFINITY;
+  items[2].data.d = -0.0;
+  items[3].data.d = INFINITY;
+  item_sort(items, COUNT, NULL);
+  CHECK_TRUE(_sorted(items, COUNT, item_compare));
+  CHECK_TRUE(isinf(items[0].data.d) && items[0].data.d < 0);
+  CHECK_TRUE(isnan(items[COUNT - 1].data.d));
+
+  // Few distinct values, with a comparator, through the introsort.
+  for (int i = 0; i < COUNT; i++)
+    items[i] = (item_t) { .type = 'i', .data.i = rand() % 4 };
+  item_sort(items, COUNT, _descending);
+  CHECK_TRUE(_sorted(items, COUNT, _descending));
+
+  // Already sorted and reversed input.
+  item_sort(items, COUNT, NULL);
+  CHECK_TRUE(_sorted(items, COUNT, item_compare));
+  for (int i = 0; i < COUNT; i++)
+    items[i] = (item_t) { .type = 'c', .data.c = (char) (COUNT - i) };
+  item_sort(items, COUNT, NULL);
+  CHECK_TRUE(_sorted(items, COUNT, item_compare));
+
+  // Mixed kinds and small arrays.
+  item_t mixed[] = {
+    { .type = 'S', .data.S = "b" }, { .type = 'i', .data.i = 2 },
+    { .type = 'S', .data.S = "a" }, { .type = 'i', .data.i = 1 },
+  };
+  item_sort(mixed, 4, NULL);
+  CHECK_TRUE(_sorted(mixed, 4, item_compare));
+  CHECK_EQ_INT(mixed[0].data.i, 1);
+  CHECK_TRUE(strcmp(mixed[2].data.S, "a") == 0);
+  item_sort(mixed, 0, NULL);
+
+  free(items);
+})
+
+MAIN_RUN_TESTS(strings, cached_strings, hashing, inline_strings, compare, sort)
@@ -0,0 +1,105 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdio.h>
+#include <string.h>
+#include "mtest.h"
+#include "lhash.h"
+
+TEST_CASE(smoke, {
+  lhash_t* map = lhash_new(4);
+  int a = 1, b = 2;
+
+  CHECK_TRUE(lhash_get(map, "Germany") == NULL);
+  CHECK_TRUE(lhash_put(map, "Germany", &a) == &a);
+  CHECK_TRUE(lhash_get(map, "Germany") == &a);
+  CHECK_TRUE(lhash_put(map, "Germany", &b) == &b);
+  CHECK_TRUE(lhash_get(map, "Germany") == &b);
+  CHECK_EQ_INT(lhash_count(map), 1);
+
+  CHECK_TRUE(lhash_remove(map, "Germany") == &b);
+  CHECK_TRUE(lhash_get(map, "Germany") == NULL);
+  CHECK_TRUE(lhash_remove(map, "Germany") == NULL);
+  CHECK_EQ_INT(lhash_count(map), 0);
+  CHECK_TRUE(lhash_oldest(map) == NULL);
+  CHECK_TRUE(lhash_evict(map) == NULL);
+
+  lhash_free(map);
+})
+
+TEST_CASE(insertion_order, {
+  lhash_t* map = lhash_new(4);
+  int a = 1, b = 2, c = 3;
+
+  lhash_put(map, "Germany", &a);
+  lhash_put(map, "Denmark", &b);
+  lhash_put(map, "Sweden", &c);
+
+  // Gets and updates do not change the order.
+  lhash_get(map, "Germany");
+  lhash_put(map, "Germany", &a);
+  CHECK_TRUE(strcmp(lhash_oldest(map), "Germany") == 0);
+
+  // Unless asked to.
+  CHECK_EQ_INT(lhash_move_to_front(map, "Germany"), 0);
+  CHECK_EQ_INT(lhash_move_to_front(map, "Norway"), -1);
+  CHECK_TRUE(strcmp(lhash_oldest(map), "Denmark") == 0);
+
+  CHECK_TRUE(lhash_evict(map) == &b);
+  CHECK_TRUE(lhash_get(map, "Denmark") == NULL);
+  CHECK_TRUE(lhash_evict(map) == &c);
+  CHECK_TRUE(lhash_evict(map) == &a);
+  CHECK_EQ_INT(lhash_count(map), 0);
+
+  lhash_free(map);
+})
+
+TEST_CASE(access_order, {
+  lhash_t* map = lhash_new_flags(0, LHASH_ACCESS_ORDER);
+  static int values[100];
+  char key[16];
+
+  for (int i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    lhash_put(map, key, &values[i]);
+  }
+  // Touch every even key, leaving the odd ones as the least recent.
+  for (int i = 0; i < 100; i += 2) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(lhash_get(map, key) == &values[i]);
+  }
+  for (int i = 1; i < 100; i += 2)
+    CHECK_TRUE(lhash_evict(map) == &values[i]);
+  for (int i = 0; i < 100; i += 2)
+    CHECK_TRUE(lhash_evict(map) == &values[i]);
+  CHECK_EQ_INT(lhash_count(map), 0);
+
+  lhash_free(map);
+})
+
+// Caps a map at a few keys, as a cache would, so keys come and go.
+TEST_CASE(bounded, {
+  lhash_t* map = lhash_new_flags(0, LHASH_ACCESS_ORDER);
+  static int values[1000];
+  char key[16];
+
+  for (int i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    lhash_put(map, key, &values[i]);
+    if (lhash_count(map) > 10)
+      lhash_evict(map);
+  }
+  CHECK_EQ_INT(lhash_count(map), 10);
+  CHECK_EQ_INT(list_length(map->order), 10);
+  for (int i = 0; i < 1000; i++) {
+    snprintf(key, sizeof(key), "key%d", i);
+    CHECK_TRUE(lhash_get(map, key) == (i >= 990 ? &values[i] : NULL));
+  }
+
+  lhash_free(map);
+})
+
+MAIN_RUN_TESTS(smoke, insertion_order, access_order, bounded)
@@ -4,6 +4,15 @@
 // clause) to any licence for distributing derivative works that have
 // been produced by the normal use of the Work as a library.
 
+#include <stdlib.h>
+#include <string.h>
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+#include <malloc.h>
+#define HEAP_IN_USE() mallinfo2().uordblks
+#else
+#define HEAP_IN_USE() ((size_t) 0)
+#endif
+
 #include "mtest.h"
 #include "item.h"
 #include "list.h"
@@ -22,11 +31,11 @@ TEST_CASE(create_and_free, {
 
 TEST_CASE(insert, {
   node_t* const list = list_new();
-  list_elem_insert((node_t*) list, (item_t) { .type = 'i', .data.i = 42 });
+  list_elem_insert(list, (node_t*) list, (item_t) { .type = 'i', .data.i = 42 });
   CHECK_EQ_INT(list->next->item.data.i, 42);
   CHECK_EQ_INT(list->prev->item.data.i, 42);
 
-  list_elem_insert((node_t*) list, (item_t) { .type = 'd', .data.d = 4.2 });
+  list_elem_insert(list, (node_t*) list, (item_t) { .type = 'd', .data.d = 4.2 });
   CHECK_EQ_CHAR(list->next->item.type, 'd');
   CHECK_EQ_DOUBLE(list->next->item.data.d, 4.2, 0.001);
 
@@ -70,17 +79,17 @@ TEST_CASE(delete, {
   list_append(list, third);
 
   item_t result;
-  result = list_elem_remove(list->next->next);
+  result = list_elem_remove(list, list->next->next);
   CHECK_TRUE(item_equal(second, result));
 
-  result = list_elem_remove(list->prev->prev);
+  result = list_elem_remove(list, list->prev->prev);
   CHECK_TRUE(item_equal(first, result));
 
-  result = list_elem_remove(list->next);
+  result = list_elem_remove(list, list->next);
   CHECK_TRUE(item_equal(third, result));
 
   // Ensure we do not delete the sentinel and instead return ITEM_NULL.
-  result = list_elem_remove(list->prev);
+  result = list_elem_remove(list, list->prev);
   CHECK_TRUE(item_equal(ITEM_NULL, result));
 
   list_free(list);
@@ -94,16 +103,22 @@ TEST_CASE(length, {
 
   list_prepend(list, (item_t) { .type = 'i', .data.i = 42 });
   CHECK_EQ_INT(list_length(list), 1);
+  CHECK_TRUE(list_empty(list) == 0);
   list_prepend(list, (item_t) { .type = 'i', .data.i = 69 });
   CHECK_EQ_INT(list_length(list), 2);
   list_append(list, (item_t) { .type = 'i', .data.i = 21 });
   CHECK_EQ_INT(list_length(list), 3);
 
-  (void) list_elem_remove(list->next);
+  (void) list_elem_remove(list, list->next);
   CHECK_EQ_INT(list_length(list), 2);
-  (void) list_elem_remove(list->next);
+  (void) list_elem_remove(list, list->next);
   CHECK_EQ_INT(list_length(list), 1);
-  (void) list_elem_remove(list->next);
+  (void) list_elem_remove(list, list->next);
+  CHECK_EQ_INT(list_length(list), 0);
+  CHECK_TRUE(list_empty(list) != 0);
+
+  // Removing the sentinel is refused, and does not change the length.
+  (void) list_elem_remove(list, list);
   CHECK_EQ_INT(list_length(list), 0);
 
   list_free(list);
@@ -140,6 +155,8 @@ TEST_CASE(indexing, {
   // Out of bounds.
   CHECK_TRUE(list_at(list, 3) == NULL);
   CHECK_TRUE(list_at(list, -4) == NULL);
+  CHECK_TRUE(list_at(list, 2) == list->prev);
+  CHECK_TRUE(list_at(list, -3) == list->next);
   // Large values should not affect the speed of return.
   CHECK_TRUE(list_at(list, 100000000) == NULL);
   CHECK_TRUE(list_at(list, -100000000) == NULL);
@@ -169,4 +186,360 @@ TEST_CASE(find, {
   list_free(list);
 })
 
-MAIN_RUN_TESTS(create_and_free, insert, prepend_append, delete, length, indexing, find)
+TEST_CASE(find_typed, {
+  node_t* const list = list_new();
+
+  list_append(list, (item_t) { .type = 'd', .data.d = 42.0 });
+  list_append(list, (item_t) { .type = 'S', .data.S = "Denmark" });
+  list_append(list, item_str("Germany"));
+  list_append(list, item_str("Sweden"));
+  list_append(list, (item_t) { .type = 'i', .data.i = 42 });
+  list_append(list, item_string("Norway"));
+
+  CHECK_TRUE(list_find_int(list, 42) == list->prev->prev);
+  CHECK_TRUE(list_find_int(list, 21) == NULL);
+
+  CHECK_TRUE(list_find_str(list, "Denmark") == list_at(list, 1));
+  CHECK_TRUE(list_find_str(list, "Germany") == list_at(list, 2));
+  CHECK_TRUE(list_find_str(list, "Sweden") == list_at(list, 3));
+  CHECK_TRUE(list_find_str(list, "Norway") == list->prev);
+  CHECK_TRUE(list_find_str(list, "Finland") == NULL);
+  CHECK_TRUE(list_find_str(list, "") == NULL);
+  // Agrees with a plain find.
+  CHECK_TRUE(list_find_str(list, "Sweden") == list_find(list, (item_t) { .type = 'S', .data.S = "Sweden" }));
+
+  list_free(list);
+})
+
+TEST_CASE(pooled, {
+  node_pool_t* pool = list_pool_new(4);
+  REQUIRE_TRUE(pool != NULL);
+  node_t* const list = list_new_pooled(pool);
+  // Hand the pool over to the list, it is now freed along with it.
+  list_pool_free(pool);
+
+  for (int i = 0; i < 100; i++)
+    REQUIRE_TRUE(list_append(list, (item_t) { .type = 'i', .data.i = i }) != NULL);
+  CHECK_EQ_INT(list_length(list), 100);
+  CHECK_EQ_INT(list_at(list, 42)->item.data.i, 42);
+
+  // Nodes come from a slab one after another.
+  CHECK_TRUE(list->next->next == list->next + 1);
+
+  // Removed nodes are recycled before the slab is touched again.
+  node_t* removed = list->next->next;
+  CHECK_EQ_INT(list_elem_remove(list, removed).data.i, 1);
+  CHECK_TRUE(list_prepend(list, (item_t) { .type = 'i', .data.i = -1 }) == removed);
+  CHECK_EQ_INT(list_at(list, 0)->item.data.i, -1);
+
+  list_free(list);
+})
+
+TEST_CASE(pool_shared, {
+  node_pool_t* pool = list_pool_new(0);
+  node_t* const first = list_new_pooled(pool);
+  node_t* const second = list_new_pooled(pool);
+
+  for (int i = 0; i < 10; i++) {
+    list_append(first, (item_t) { .type = 'i', .data.i = i });
+    list_append(second, (item_t) { .type = 'i', .data.i = -i });
+  }
+  CHECK_EQ_INT(pool->refs, 3);
+
+  // Nodes of a freed list go back to the pool, for the other to use.
+  node_t* last = first->prev;
+  list_free(first);
+  CHECK_EQ_INT(pool->refs, 2);
+  CHECK_TRUE(pool->free == last);
+  CHECK_TRUE(list_append(second, (item_t) { .type = 'i', .data.i = 42 }) != NULL);
+  CHECK_EQ_INT(list_length(second), 11);
+  CHECK_EQ_INT(list_at(second, -1)->item.data.i, 42);
+
+  list_pool_free(pool);
+  list_free(second);
+})
+
+TEST_CASE(splice_concat, {
+  node_t* const list = list_new();
+  node_t* const other = list_new();
+  for (int i = 0; i < 3; i++) {
+    list_append(list, (item_t) { .type = 'i', .data.i = i });
+    list_append(other, (item_t) { .type = 'i', .data.i = 10 + i });
+  }
+
+  // Move 11 and 12 to right after 0.
+  node_t* moved = other->next->next;
+  REQUIRE_EQ_INT(list_splice(list, list->next, other, moved, other->prev), 0);
+  CHECK_EQ_INT(list_length(list), 5);
+  CHECK_EQ_INT(list_length(other), 1);
+  CHECK_EQ_INT(list_at(list, 1)->item.data.i, 11);
+  CHECK_EQ_INT(list_at(list, 2)->item.data.i, 12);
+  CHECK_EQ_INT(list_at(list, 3)->item.data.i, 1);
+  CHECK_TRUE(list_at(list, 1) == moved);
+  CHECK_EQ_INT(list_elem_remove(list, moved).data.i, 11);
+  CHECK_EQ_INT(list_length(list), 4);
+
+  // Within the same list, move 0 and 12 to the end.
+  REQUIRE_EQ_INT(list_splice(list, list->prev, list, list->next, list->next->next), 0);
+  CHECK_EQ_INT(list_length(list), 4);
+  CHECK_EQ_INT(list_at(list, 0)->item.data.i, 1);
+  CHECK_EQ_INT(list_at(list, 2)->item.data.i, 0);
+  CHECK_EQ_INT(list_at(list, 3)->item.data.i, 12);
+
+  REQUIRE_EQ_INT(list_concat(list, other), 0);
+  CHECK_EQ_INT(list_length(list), 5);
+  CHECK_EQ_INT(list_at(list, -1)->item.data.i, 10);
+  CHECK_TRUE(list_empty(other) != 0);
+  CHECK_EQ_INT(list_length(other), 0);
+  // Concatenating an empty list changes nothing.
+  REQUIRE_EQ_INT(list_concat(list, other), 0);
+  CHECK_EQ_INT(list_length(list), 5);
+
+  // Nodes can not move between pools.
+  node_pool_t* pool = list_pool_new(0);
+  node_t* const pooled = list_new_pooled(pool);
+  list_pool_free(pool);
+  list_append(pooled, (item_t) { .type = 'i', .data.i = 42 });
+  CHECK_EQ_INT(list_concat(list, pooled), -1);
+  CHECK_EQ_INT(list_splice(pooled, pooled, list, list->next, list->prev), -1);
+  CHECK_EQ_INT(list_length(pooled), 1);
+
+  list_free(pooled);
+  list_free(other);
+  list_free(list);
+})
+
+TEST_CASE(concat_chain, {
+  node_t* lists[4];
+  for (int l = 0; l < 4; l++) {
+    lists[l] = list_new();
+    for (int i = 0; i < 3; i++)
+      list_append(lists[l], (item_t) { .type = 'i', .data.i = l * 10 + i });
+  }
+  node_t* from_last = lists[3]->next;
+
+  // Each list goes into the one before it, so the elements of the last
+  // list end up in the first one.
+  for (int l = 3; l > 0; l--) {
+    REQUIRE_EQ_INT(list_concat(lists[l - 1], lists[l]), 0);
+    CHECK_EQ_INT(list_length(lists[l]), 0);
+  }
+  CHECK_EQ_INT(list_length(lists[0]), 12);
+  CHECK_TRUE(list_at(lists[0], 9) == from_last);
+  CHECK_EQ_INT(list_elem_remove(lists[0], from_last).data.i, 30);
+  CHECK_EQ_INT(list_length(lists[0]), 11);
+  CHECK_TRUE(list_elem_insert(lists[0], lists[0]->prev, (item_t) { .type = 'i', .data.i = 99 }) != NULL);
+  CHECK_EQ_INT(list_length(lists[0]), 12);
+
+  // The emptied lists are lists of their own again.
+  list_append(lists[2], (item_t) { .type = 'i', .data.i = 7 });
+  CHECK_EQ_INT(list_length(lists[2]), 1);
+  CHECK_EQ_INT(list_length(lists[0]), 12);
+  list_elem_remove(lists[2], lists[2]->next);
+  CHECK_EQ_INT(list_length(lists[2]), 0);
+
+  // The first list splits, empties and fills up again.
+  node_t* rest = list_split_at(lists[0], 4);
+  REQUIRE_TRUE(rest != NULL);
+  CHECK_EQ_INT(list_length(rest), 8);
+  while (!list_empty(lists[0]))
+    list_elem_remove(lists[0], lists[0]->next);
+  CHECK_EQ_INT(list_length(lists[0]), 0);
+  list_elem_remove(rest, rest->next);
+  CHECK_EQ_INT(list_length(rest), 7);
+  REQUIRE_EQ_INT(list_concat(lists[0], rest), 0);
+  CHECK_EQ_INT(list_length(lists[0]), 7);
+
+  list_free(rest);
+  for (int l = 0; l < 4; l++)
+    list_free(lists[l]);
+})
+
+// A queue which is fed by concatenating batches onto it, and never
+// drained all the way, uses no more memory the longer it runs.
+TEST_CASE(concat_queue, {
+  node_pool_t* pool = list_pool_new(0);
+  node_t* const queue = list_new_pooled(pool);
+  node_t* const batch = list_new_pooled(pool);
+  list_pool_free(pool);
+  list_append(queue, (item_t) { .type = 'i', .data.i = -1 });
+
+  node_slab_t* slabs = NULL;
+  node_t* bump = NULL;
+  size_t heap = 0;
+  for (int i = 0; i < 100000; i++) {
+    REQUIRE_TRUE(list_append(batch, (item_t) { .type = 'i', .data.i = i }) != NULL);
+    REQUIRE_EQ_INT(list_concat(queue, batch), 0);
+    REQUIRE_EQ_INT(list_elem_remove(queue, queue->next).data.i, i - 1);
+    if (i == 0) {
+      slabs = pool->slabs;
+      bump = pool->bump;
+      heap = HEAP_IN_USE();
+    }
+  }
+  CHECK_EQ_INT(list_length(queue), 1);
+  CHECK_EQ_INT(list_length(batch), 0);
+  // Every cycle reused the node the one before it gave back.
+  CHECK_TRUE(pool->slabs == slabs && slabs->next == NULL);
+  CHECK_TRUE(pool->bump == bump);
+  CHECK_TRUE(HEAP_IN_USE() <= heap);
+
+  list_free(batch);
+  list_free(queue);
+})
+
+TEST_CASE(split, {
+  node_t* const list = list_new();
+  for (int i = 0; i < 5; i++)
+    list_append(list, (item_t) { .type = 'i', .data.i = i });
+
+  CHECK_TRUE(list_split_at(list, 6) == NULL);
+  CHECK_TRUE(list_split_at(list, -6) == NULL);
+
+  node_t* const rest = list_split_at(list, -2);
+  REQUIRE_TRUE(rest != NULL);
+  CHECK_EQ_INT(list_length(list), 3);
+  CHECK_EQ_INT(list_length(rest), 2);
+  CHECK_EQ_INT(list_at(list, -1)->item.data.i, 2);
+  CHECK_EQ_INT(list_at(rest, 0)->item.data.i, 3);
+  CHECK_EQ_INT(list_at(rest, 1)->item.data.i, 4);
+  // Elements moved over count towards their new list.
+  CHECK_EQ_INT(list_elem_remove(rest, rest->next).data.i, 3);
+  CHECK_EQ_INT(list_length(rest), 1);
+  CHECK_EQ_INT(list_length(list), 3);
+  list_prepend(rest, (item_t) { .type = 'i', .data.i = 3 });
+
+  node_t* const empty = list_split_at(list, 3);
+  REQUIRE_TRUE(empty != NULL);
+  CHECK_TRUE(list_empty(empty) != 0);
+  CHECK_EQ_INT(list_length(list), 3);
+
+  node_t* const all = list_split_at(list, 0);
+  REQUIRE_TRUE(all != NULL);
+  CHECK_TRUE(list_empty(list) != 0);
+  CHECK_EQ_INT(list_length(all), 3);
+  CHECK_EQ_INT(list_at(all, 0)->item.data.i, 0);
+
+  list_free(all);
+  list_free(empty);
+  list_free(rest);
+  list_free(list);
+})
+
+TEST_CASE(append_array, {
+  item_t items[100];
+  for (int i = 0; i < 100; i++)
+    items[i] = (item_t) { .type = 'i', .data.i = i };
+
+  node_t* const list = list_new();
+  list_append(list, (item_t) { .type = 'i', .data.i = -1 });
+  REQUIRE_EQ_INT(list_append_array(list, items, 3), 0);
+  REQUIRE_EQ_INT(list_append_array(list, items, 0), 0);
+  CHECK_EQ_INT(list_length(list), 4);
+  CHECK_EQ_INT(list_at(list, 0)->item.data.i, -1);
+  CHECK_EQ_INT(list_at(list, 3)->item.data.i, 2);
+  CHECK_EQ_INT(list_elem_remove(list, list_at(list, 2)).data.i, 1);
+  list_free(list);
+
+  node_pool_t* pool = list_pool_new(4);
+  node_t* const pooled = list_new_pooled(pool);
+  list_pool_free(pool);
+  // Fits in the current slab, then needs a fresh one, then one of its own.
+  REQUIRE_EQ_INT(list_append_array(pooled, items, 3), 0);
+  REQUIRE_EQ_INT(list_append_array(pooled, items + 3, 7), 0);
+  REQUIRE_EQ_INT(list_append_array(pooled, items + 10, 90), 0);
+  CHECK_EQ_INT(list_length(pooled), 100);
+  for (int i = 0; i < 100; i++)
+    CHECK_EQ_INT(list_at(pooled, i)->item.data.i, i);
+  // Each batch sits in one block.
+  CHECK_TRUE(list_at(pooled, 2) == list_at(pooled, 0) + 2);
+  CHECK_TRUE(list_at(pooled, 9) == list_at(pooled, 3) + 6);
+  CHECK_TRUE(list_at(pooled, 99) == list_at(pooled, 10) + 89);
+
+  // The nodes are recycled like any other.
+  node_t* removed = list_at(pooled, 50);
+  (void) list_elem_remove(pooled, removed);
+  CHECK_TRUE(list_append(pooled, (item_t) { .type = 'i', .data.i = 100 }) == removed);
+  list_free(pooled);
+})
+
+static int _by_tens(item_t left, item_t right) {
+  return (left.data.i / 10 > right.data.i / 10) - (left.data.i / 10 < right.data.i / 10);
+}
+
+TEST_CASE(sort, {
+  node_t* const list = list_new();
+  // Sorting empty and single element lists is fine.
+  list_sort(list, NULL);
+  CHECK_EQ_INT(list_sort_array(list, NULL), 0);
+  list_append(list, (item_t) { .type = 'i', .data.i = 1 });
+  list_sort(list, NULL);
+  CHECK_EQ_INT(list_at(list, 0)->item.data.i, 1);
+  (void) list_elem_remove(list, list->next);
+
+  srand(42);
+  for (int i = 0; i < 1000; i++)
+    list_append(list, (item_t) { .type = 'i', .data.i = rand() % 100 });
+
+  // Elements keep their items, only the links change.
+  node_t* first = list->next;
+  item_t first_item = first->item;
+  list_sort(list, _by_tens);
+  CHECK_EQ_INT(list_length(list), 1000);
+  CHECK_TRUE(item_equal(first->item, first_item));
+  int ordered = 1;
+  for (node_t* current = list->next->next; current != list; current = current->next)
+    ordered &= _by_tens(current->prev->item, current->item) <= 0 && current->prev->next == current;
+  CHECK_TRUE(ordered);
+  CHECK_TRUE(list->prev->next == list);
+
+  list_sort(list, NULL);
+  ordered = 1;
+  for (node_t* current = list->next->next; current != list; current = current->next)
+    ordered &= current->prev->item.data.i <= current->item.data.i;
+  CHECK_TRUE(ordered);
+
+  list_free(list);
+})
+
+TEST_CASE(sort_stable, {
+  node_t* const list = list_new();
+  // Tag items with their position in the tens, so ties can be checked.
+  for (int i = 0; i < 100; i++)
+    list_append(list, (item_t) { .type = 'i', .data.i = (i % 7) * 10 + i / 10 });
+  list_sort(list, _by_tens);
+  int stable = 1;
+  for (node_t* current = list->next->next; current != list; current = current->next)
+    if (_by_tens(current->prev->item, current->item) == 0)
+      stable &= current->prev->item.data.i % 10 <= current->item.data.i % 10;
+  CHECK_TRUE(stable);
+  list_free(list);
+})
+
+TEST_CASE(sort_array, {
+  node_t* const list = list_new();
+  srand(7);
+  for (int i = 0; i < 2000; i++)
+    list_append(list, (item_t) { .type = 'i', .data.i = rand() - RAND_MAX / 2 });
+  node_t* first = list->next;
+
+  REQUIRE_EQ_INT(list_sort_array(list, NULL), 0);
+  CHECK_EQ_INT(list_length(list), 2000);
+  // The nodes stay where they were, their items move.
+  CHECK_TRUE(list->next == first);
+  int ordered = 1;
+  for (node_t* current = list->next->next; current != list; current = current->next)
+    ordered &= current->prev->item.data.i <= current->item.data.i;
+  CHECK_TRUE(ordered);
+
+  list_append(list, item_string("Sweden"));
+  list_append(list, item_string("Denmark"));
+  REQUIRE_EQ_INT(list_sort_array(list, NULL), 0);
+  CHECK_TRUE(strcmp(item_cstr(&list->prev->item), "Sweden") == 0);
+  CHECK_TRUE(strcmp(item_cstr(&list->prev->prev->item), "Denmark") == 0);
+
+  list_free(list);
+})
+
+MAIN_RUN_TESTS(create_and_free, insert, prepend_append, delete, length, indexing, find, find_typed, pooled, pool_shared,
+               splice_concat, concat_chain, concat_queue, split, append_array, sort, sort_stable, sort_array)
@@ -0,0 +1,93 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "mtest.h"
+#include "item.h"
+#include "mpmc.h"
+
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define ITEMS_PER_PRODUCER 100000
+
+static mpmc_t* shared;
+static atomic_int seen[PRODUCERS * ITEMS_PER_PRODUCER];
+static atomic_int consumed;
+
+TEST_CASE(fifo, {
+  mpmc_t* queue = mpmc_new(3);
+  // Rounded up to a power of two.
+  CHECK_EQ_INT(queue->mask, 3);
+
+  CHECK_TRUE(item_equal(mpmc_remove(queue), ITEM_NULL));
+  for (int i = 0; i < 4; i++)
+    CHECK_EQ_INT(mpmc_append(queue, (item_t) { .type = 'i', .data.i = i }), 0);
+  CHECK_EQ_INT(mpmc_append(queue, (item_t) { .type = 'i', .data.i = 4 }), -1);
+  CHECK_EQ_INT(mpmc_length(queue), 4);
+
+  // Go around the ring a few times.
+  for (int i = 0; i < 20; i++) {
+    CHECK_EQ_INT(mpmc_remove(queue).data.i, i);
+    CHECK_EQ_INT(mpmc_append(queue, (item_t) { .type = 'i', .data.i = i + 4 }), 0);
+  }
+  for (int i = 20; i < 24; i++)
+    CHECK_EQ_INT(mpmc_remove(queue).data.i, i);
+  CHECK_TRUE(item_equal(mpmc_remove(queue), ITEM_NULL));
+  CHECK_EQ_INT(mpmc_length(queue), 0);
+
+  mpmc_free(queue);
+})
+
+static void* producer(void* arg) {
+  int first = (int) (size_t) arg * ITEMS_PER_PRODUCER;
+  for (int i = first; i < first + ITEMS_PER_PRODUCER; i++)
+    while (mpmc_append(shared, (item_t) { .type = 'i', .data.i = i }) == -1)
+      sched_yield();
+  return NULL;
+}
+
+static void* consumer(void* arg) {
+  (void) arg;
+  while (atomic_load(&consumed) < PRODUCERS * ITEMS_PER_PRODUCER) {
+    item_t item = mpmc_remove(shared);
+    if (item.type != 'i') {
+      sched_yield();
+      continue;
+    }
+    atomic_fetch_add(&seen[item.data.i], 1);
+    atomic_fetch_add(&consumed, 1);
+  }
+  return NULL;
+}
+
+TEST_CASE(threads, {
+  pthread_t producers[PRODUCERS];
+  pthread_t consumers[CONSUMERS];
+
+  // Small, so producers keep running into a full queue.
+  shared = mpmc_new(64);
+  for (size_t i = 0; i < CONSUMERS; i++)
+    pthread_create(&consumers[i], NULL, consumer, NULL);
+  for (size_t i = 0; i < PRODUCERS; i++)
+    pthread_create(&producers[i], NULL, producer, (void*) i);
+  for (size_t i = 0; i < PRODUCERS; i++)
+    pthread_join(producers[i], NULL);
+  for (size_t i = 0; i < CONSUMERS; i++)
+    pthread_join(consumers[i], NULL);
+
+  // Every item came out exactly once.
+  int wrong = 0;
+  for (int i = 0; i < PRODUCERS * ITEMS_PER_PRODUCER; i++)
+    wrong += atomic_load(&seen[i]) != 1;
+  CHECK_EQ_INT(wrong, 0);
+  CHECK_EQ_INT(mpmc_length(shared), 0);
+
+  mpmc_free(shared);
+})
+
+MAIN_RUN_TESTS(fifo, threads)
@@ -0,0 +1,154 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include "mtest.h"
+#include "item.h"
+#include "pheap.h"
+
+static item_t _int(int i) {
+  return (item_t) { .type = 'i', .data.i = i };
+}
+
+TEST_CASE(create_and_free, {
+  pheap_t* heap = pheap_new(NULL);
+
+  REQUIRE_TRUE(heap != NULL);
+  CHECK_TRUE(pheap_empty(heap) != 0);
+  CHECK_EQ_INT(pheap_length(heap), 0);
+  CHECK_TRUE(pheap_peek(heap) == NULL);
+  CHECK_TRUE(item_equal(pheap_pop(heap), ITEM_NULL));
+
+  // Frees whatever is still in there.
+  for (int i = 0; i < 100; i++)
+    REQUIRE_TRUE(pheap_push(heap, _int(i % 7)) != NULL);
+  pheap_pop(heap);
+  pheap_free(heap);
+})
+
+TEST_CASE(push_pop, {
+  pheap_t* heap = pheap_new(NULL);
+  srand(42);
+
+  for (int i = 0; i < 1000; i++)
+    REQUIRE_TRUE(pheap_push(heap, _int(rand() % 500)) != NULL);
+  CHECK_EQ_INT(pheap_length(heap), 1000);
+
+  int last = -1;
+  int ordered = 1;
+  while (!pheap_empty(heap)) {
+    int top = pheap_peek(heap)->data.i;
+    int popped = pheap_pop(heap).data.i;
+    ordered &= top == popped && popped >= last;
+    last = popped;
+  }
+  CHECK_TRUE(ordered);
+
+  pheap_free(heap);
+})
+
+TEST_CASE(decrease_remove, {
+  pheap_t* heap = pheap_new(NULL);
+  pnode_t* nodes[100];
+  for (int i = 0; i < 100; i++)
+    nodes[i] = pheap_push(heap, _int(100 + i));
+  // Gives the tree some shape first.
+  CHECK_EQ_INT(pheap_pop(heap).data.i, 100);
+
+  REQUIRE_EQ_INT(pheap_decrease(heap, nodes[50], _int(1)), 0);
+  CHECK_EQ_INT(pheap_peek(heap)->data.i, 1);
+  CHECK_EQ_INT(pheap_decrease(heap, nodes[60], _int(500)), -1);
+  CHECK_EQ_INT(nodes[60]->item.data.i, 160);
+
+  // Removing from the middle, and the root itself.
+  CHECK_EQ_INT(pheap_remove(heap, nodes[70]).data.i, 170);
+  CHECK_EQ_INT(pheap_remove(heap, nodes[50]).data.i, 1);
+  CHECK_EQ_INT(pheap_length(heap), 97);
+
+  int last = -1;
+  int ordered = 1;
+  while (!pheap_empty(heap)) {
+    int popped = pheap_pop(heap).data.i;
+    ordered &= popped > last && popped != 170;
+    last = popped;
+  }
+  CHECK_TRUE(ordered);
+  CHECK_EQ_INT(last, 199);
+
+  pheap_free(heap);
+})
+
+TEST_CASE(meld, {
+  pheap_t* evens = pheap_new(NULL);
+  pheap_t* odds = pheap_new(NULL);
+  for (int i = 0; i < 50; i++) {
+    pheap_push(evens, _int(2 * i));
+    pheap_push(odds, _int(2 * i + 1));
+  }
+  pnode_t* node = pheap_push(odds, _int(1001));
+
+  pheap_meld(evens, odds);
+  CHECK_EQ_INT(pheap_length(evens), 101);
+  CHECK_TRUE(pheap_empty(odds) != 0);
+  // The nodes of the other heap now belong to this one.
+  REQUIRE_EQ_INT(pheap_decrease(evens, node, _int(-1)), 0);
+
+  int ordered = pheap_pop(evens).data.i == -1;
+  for (int i = 0; i < 100; i++)
+    ordered &= pheap_pop(evens).data.i == i;
+  CHECK_TRUE(ordered);
+
+  pheap_meld(evens, odds);
+  CHECK_TRUE(pheap_empty(evens) != 0);
+  pheap_free(odds);
+  pheap_free(evens);
+})
+
+// Mirrors random pushes, pops, decreases and removes in a plain array.
+TEST_CASE(random_ops, {
+  enum { COUNT = 1000 };
+  pheap_t* heap = pheap_new(NULL);
+  static pnode_t* nodes[COUNT];
+  static int values[COUNT];
+  int length = 0;
+  srand(42);
+
+  for (int step = 0; step < 50000; step++) {
+    int op = rand() % 4;
+    if (length == 0 || (op == 0 && length < COUNT)) {
+      values[length] = rand() % 10000;
+      nodes[length] = pheap_push(heap, _int(values[length]));
+      REQUIRE_TRUE(nodes[length] != NULL);
+      length += 1;
+      continue;
+    }
+    int i = rand() % length;
+    if (op == 1) {
+      int least = 0;
+      for (int j = 1; j < length; j++)
+        if (values[j] < values[least]) least = j;
+      // Equal values may come out in any order, so follow the root.
+      for (i = 0; nodes[i] != heap->root; i++);
+      REQUIRE_EQ_INT(values[i], values[least]);
+      REQUIRE_EQ_INT(pheap_pop(heap).data.i, values[least]);
+    } else if (op == 2) {
+      values[i] -= rand() % 1000;
+      REQUIRE_EQ_INT(pheap_decrease(heap, nodes[i], _int(values[i])), 0);
+      continue;
+    } else {
+      REQUIRE_EQ_INT(pheap_remove(heap, nodes[i]).data.i, values[i]);
+    }
+    // Gone, so the last one takes its place.
+    length -= 1;
+    nodes[i] = nodes[length];
+    values[i] = values[length];
+    REQUIRE_EQ_INT(pheap_length(heap), length);
+  }
+
+  pheap_free(heap);
+})
+
+MAIN_RUN_TESTS(create_and_free, push_pop, decrease_remove, meld, random_ops)
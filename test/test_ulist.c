@@ -0,0 +1,137 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include <string.h>
+#include "mtest.h"
+#include "item.h"
+#include "ulist.h"
+
+TEST_CASE(create_and_free, {
+  unode_t* const list = ulist_new();
+
+  // Ensure sentinel is properly configured.
+  CHECK_TRUE(list->next == list);
+  CHECK_TRUE(list->prev == list);
+  CHECK_TRUE(ulist_empty(list) != 0);
+  CHECK_EQ_INT(ulist_length(list), 0);
+
+  ulist_free(list);
+})
+
+TEST_CASE(prepend_append, {
+  unode_t* const list = ulist_new();
+
+  ulist_prepend(list, (item_t) { .type = 'i', .data.i = 42 });
+  ulist_prepend(list, (item_t) { .type = 'i', .data.i = 69 });
+  ulist_append(list, (item_t) { .type = 'i', .data.i = 21 });
+
+  CHECK_EQ_INT(ulist_length(list), 3);
+  CHECK_EQ_INT(ulist_at(list, 0)->data.i, 69);
+  CHECK_EQ_INT(ulist_at(list, 1)->data.i, 42);
+  CHECK_EQ_INT(ulist_at(list, 2)->data.i, 21);
+  // All three share a single node.
+  CHECK_TRUE(list->next == list->prev);
+
+  ulist_free(list);
+})
+
+TEST_CASE(indexing, {
+  unode_t* const list = ulist_new();
+  for (int i = 0; i < 100; i++)
+    REQUIRE_EQ_INT(ulist_append(list, (item_t) { .type = 'i', .data.i = i }), 0);
+
+  // Appending leaves every node but the last full.
+  CHECK_EQ_INT(list->next->count, ULIST_NODE_ITEMS);
+
+  for (int i = 0; i < 100; i++) {
+    CHECK_EQ_INT(ulist_at(list, i)->data.i, i);
+    CHECK_EQ_INT(ulist_at(list, -1 - i)->data.i, 99 - i);
+  }
+
+  // Out of bounds.
+  CHECK_TRUE(ulist_at(list, 100) == NULL);
+  CHECK_TRUE(ulist_at(list, -101) == NULL);
+  CHECK_TRUE(ulist_at(list, 100000000) == NULL);
+  CHECK_TRUE(ulist_at(list, -100000000) == NULL);
+  CHECK_EQ_INT(ulist_insert(list, 101, ITEM_NULL), -1);
+
+  ulist_free(list);
+})
+
+TEST_CASE(delete, {
+  unode_t* const list = ulist_new();
+
+  item_t first = { .type = 'i', .data.i = 69 };
+  item_t second = { .type = 'i', .data.i = 42 };
+  item_t third = { .type = 'i', .data.i = 21 };
+  ulist_append(list, first);
+  ulist_append(list, second);
+  ulist_append(list, third);
+
+  CHECK_TRUE(item_equal(ulist_remove(list, 1), second));
+  CHECK_TRUE(item_equal(ulist_remove(list, -1), third));
+  CHECK_TRUE(item_equal(ulist_remove(list, 0), first));
+  CHECK_TRUE(list->next == list);
+
+  // Ensure we do not delete out of bounds and instead return ITEM_NULL.
+  CHECK_TRUE(item_equal(ulist_remove(list, 0), ITEM_NULL));
+
+  ulist_free(list);
+})
+
+TEST_CASE(find, {
+  unode_t* const list = ulist_new();
+
+  for (int i = 0; i < 50; i++)
+    ulist_append(list, (item_t) { .type = 'i', .data.i = i });
+  ulist_append(list, (item_t) { .type = 'S', .data.S = "Germany" });
+
+  CHECK_EQ_INT(ulist_find(list, (item_t) { .type = 'i', .data.i = 0 }), 0);
+  CHECK_EQ_INT(ulist_find(list, (item_t) { .type = 'i', .data.i = 37 }), 37);
+  CHECK_EQ_INT(ulist_find(list, (item_t) { .type = 'S', .data.S = "Germany" }), 50);
+  CHECK_EQ_INT(ulist_find(list, (item_t) { .type = 'i', .data.i = 50 }), -1);
+
+  ulist_free(list);
+})
+
+// Mirrors random inserts and removes in a plain array, so nodes are
+// split and merged in every which way.
+TEST_CASE(random_ops, {
+  unode_t* const list = ulist_new();
+  static int expected[2000];
+  int length = 0;
+  srand(42);
+
+  for (int step = 0; step < 20000; step++) {
+    if (length < 2000 && (length == 0 || rand() % 3 != 0)) {
+      int pos = rand() % (length + 1);
+      int value = rand();
+      REQUIRE_EQ_INT(ulist_insert(list, pos, (item_t) { .type = 'i', .data.i = value }), 0);
+      memmove(expected + pos + 1, expected + pos, (length - pos) * sizeof(int));
+      expected[pos] = value;
+      length += 1;
+    } else {
+      int pos = rand() % length;
+      REQUIRE_EQ_INT(ulist_remove(list, pos).data.i, expected[pos]);
+      memmove(expected + pos, expected + pos + 1, (length - pos - 1) * sizeof(int));
+      length -= 1;
+    }
+  }
+
+  REQUIRE_EQ_INT(ulist_length(list), length);
+  int pos = 0;
+  for (unode_t* node = list->next; node != list; node = node->next) {
+    CHECK_TRUE(node->count > 0);
+    for (unsigned int i = 0; i < node->count; i++, pos++)
+      CHECK_EQ_INT(node->items[i].data.i, expected[pos]);
+  }
+  CHECK_EQ_INT(pos, length);
+
+  ulist_free(list);
+})
+
+MAIN_RUN_TESTS(create_and_free, prepend_append, indexing, delete, find, random_ops)
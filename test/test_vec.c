@@ -0,0 +1,160 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <stdlib.h>
+#include <string.h>
+#include "mtest.h"
+#include "item.h"
+#include "vec.h"
+
+TEST_CASE(create_and_free, {
+  vec_t* vec = vec_new(0);
+
+  REQUIRE_TRUE(vec != NULL);
+  CHECK_TRUE(vec->items == NULL);
+  CHECK_TRUE(vec_empty(vec) != 0);
+  CHECK_EQ_INT(vec_length(vec), 0);
+  vec_free(vec);
+
+  vec = vec_new(100);
+  REQUIRE_TRUE(vec != NULL);
+  CHECK_EQ_INT(vec->capacity, 100);
+  CHECK_EQ_INT(vec_length(vec), 0);
+  vec_free(vec);
+})
+
+TEST_CASE(append_pop, {
+  vec_t* vec = vec_new(0);
+
+  for (int i = 0; i < 1000; i++)
+    REQUIRE_EQ_INT(vec_append(vec, (item_t) { .type = 'i', .data.i = i }), 0);
+  CHECK_EQ_INT(vec_length(vec), 1000);
+  // Grown by doubling.
+  CHECK_EQ_INT(vec->capacity, 1024);
+
+  for (int i = 999; i >= 0; i--)
+    CHECK_EQ_INT(vec_pop(vec).data.i, i);
+  CHECK_TRUE(vec_empty(vec) != 0);
+  CHECK_TRUE(item_equal(vec_pop(vec), ITEM_NULL));
+  // Popping keeps the capacity around.
+  CHECK_EQ_INT(vec->capacity, 1024);
+
+  vec_free(vec);
+})
+
+TEST_CASE(insert_remove, {
+  vec_t* vec = vec_new(0);
+
+  REQUIRE_EQ_INT(vec_insert(vec, 0, (item_t) { .type = 'i', .data.i = 42 }), 0);
+  REQUIRE_EQ_INT(vec_insert(vec, 0, (item_t) { .type = 'i', .data.i = 69 }), 0);
+  REQUIRE_EQ_INT(vec_insert(vec, 2, (item_t) { .type = 'i', .data.i = 21 }), 0);
+  REQUIRE_EQ_INT(vec_insert(vec, -1, (item_t) { .type = 'i', .data.i = 7 }), 0);
+  CHECK_EQ_INT(vec_insert(vec, 5, ITEM_NULL), -1);
+  CHECK_EQ_INT(vec_insert(vec, -5, ITEM_NULL), -1);
+
+  // 69 42 7 21
+  CHECK_EQ_INT(vec_length(vec), 4);
+  CHECK_EQ_INT(vec_at(vec, 0)->data.i, 69);
+  CHECK_EQ_INT(vec_at(vec, 1)->data.i, 42);
+  CHECK_EQ_INT(vec_at(vec, 2)->data.i, 7);
+  CHECK_EQ_INT(vec_at(vec, 3)->data.i, 21);
+
+  CHECK_EQ_INT(vec_remove(vec, 1).data.i, 42);
+  CHECK_EQ_INT(vec_remove(vec, -1).data.i, 21);
+  CHECK_TRUE(item_equal(vec_remove(vec, 2), ITEM_NULL));
+  CHECK_EQ_INT(vec_length(vec), 2);
+  CHECK_EQ_INT(vec_at(vec, 0)->data.i, 69);
+  CHECK_EQ_INT(vec_at(vec, 1)->data.i, 7);
+
+  vec_free(vec);
+})
+
+TEST_CASE(indexing, {
+  vec_t* vec = vec_new(0);
+  for (int i = 0; i < 100; i++)
+    vec_append(vec, (item_t) { .type = 'i', .data.i = i });
+
+  for (int i = 0; i < 100; i++) {
+    CHECK_EQ_INT(vec_at(vec, i)->data.i, i);
+    CHECK_EQ_INT(vec_at(vec, -1 - i)->data.i, 99 - i);
+  }
+  CHECK_TRUE(vec_at(vec, 1) == vec_at(vec, 0) + 1);
+
+  // Out of bounds.
+  CHECK_TRUE(vec_at(vec, 100) == NULL);
+  CHECK_TRUE(vec_at(vec, -101) == NULL);
+  CHECK_TRUE(vec_at(vec, 100000000) == NULL);
+
+  vec_free(vec);
+})
+
+TEST_CASE(reserve_shrink, {
+  vec_t* vec = vec_new(0);
+
+  REQUIRE_EQ_INT(vec_reserve(vec, 50), 0);
+  CHECK_EQ_INT(vec->capacity, 50);
+  item_t* items = vec->items;
+  for (int i = 0; i < 50; i++)
+    vec_append(vec, (item_t) { .type = 'i', .data.i = i });
+  // Nothing moved while within the reserved capacity.
+  CHECK_TRUE(vec->items == items);
+  // Reserving less than there is changes nothing.
+  REQUIRE_EQ_INT(vec_reserve(vec, 10), 0);
+  CHECK_EQ_INT(vec->capacity, 50);
+
+  vec_append(vec, (item_t) { .type = 'i', .data.i = 50 });
+  CHECK_EQ_INT(vec->capacity, 100);
+  REQUIRE_EQ_INT(vec_shrink(vec), 0);
+  CHECK_EQ_INT(vec->capacity, 51);
+  CHECK_EQ_INT(vec_at(vec, -1)->data.i, 50);
+
+  while (!vec_empty(vec))
+    (void) vec_pop(vec);
+  REQUIRE_EQ_INT(vec_shrink(vec), 0);
+  CHECK_EQ_INT(vec->capacity, 0);
+  CHECK_TRUE(vec->items == NULL);
+  // And it grows again from nothing.
+  REQUIRE_EQ_INT(vec_append(vec, (item_t) { .type = 'i', .data.i = 1 }), 0);
+  CHECK_EQ_INT(vec->capacity, VEC_MIN_CAPACITY);
+
+  vec_free(vec);
+})
+
+TEST_CASE(find, {
+  vec_t* vec = vec_new(0);
+
+  vec_append(vec, (item_t) { .type = 'i', .data.i = 69 });
+  vec_append(vec, (item_t) { .type = 'd', .data.d = 4.2 });
+  vec_append(vec, item_str("Germany"));
+  vec_append(vec, item_string("Norway"));
+
+  CHECK_EQ_INT(vec_find(vec, (item_t) { .type = 'i', .data.i = 69 }), 0);
+  CHECK_EQ_INT(vec_find(vec, (item_t) { .type = 'd', .data.d = 4.2 }), 1);
+  // Strings of any kind are equal, as in `list_find`.
+  CHECK_EQ_INT(vec_find(vec, (item_t) { .type = 'S', .data.S = "Germany" }), 2);
+  CHECK_EQ_INT(vec_find(vec, (item_t) { .type = 'S', .data.S = "Norway" }), 3);
+  CHECK_EQ_INT(vec_find(vec, (item_t) { .type = 'i', .data.i = 42 }), -1);
+
+  vec_free(vec);
+})
+
+TEST_CASE(sort, {
+  vec_t* vec = vec_new(0);
+  srand(42);
+  for (int i = 0; i < 1000; i++)
+    vec_append(vec, (item_t) { .type = 'i', .data.i = rand() % 500 });
+
+  vec_sort(vec, NULL);
+  CHECK_EQ_INT(vec_length(vec), 1000);
+  int ordered = 1;
+  for (int i = 1; i < 1000; i++)
+    ordered &= vec_at(vec, i - 1)->data.i <= vec_at(vec, i)->data.i;
+  CHECK_TRUE(ordered);
+
+  vec_free(vec);
+})
+
+MAIN_RUN_TESTS(create_and_free, append_pop, insert_remove, indexing, reserve_shrink, find, sort)
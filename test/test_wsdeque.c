@@ -0,0 +1,91 @@
+// Copyright © 2024 soupglasses <sofi+git@mailbox.org>
+//
+// Licensed under the EUPL, with extension of article 5 (compatibility
+// clause) to any licence for distributing derivative works that have
+// been produced by the normal use of the Work as a library.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "mtest.h"
+#include "item.h"
+#include "wsdeque.h"
+
+#define THIEVES 4
+#define ITEMS 200000
+
+static wsdeque_t* shared;
+static atomic_int seen[ITEMS];
+static atomic_int taken;
+
+TEST_CASE(ends, {
+  wsdeque_t* deque = wsdeque_new(2);
+
+  CHECK_TRUE(item_equal(wsdeque_remove(deque), ITEM_NULL));
+  CHECK_TRUE(item_equal(wsdeque_steal(deque), ITEM_NULL));
+
+  // Grows past its starting size, keeping every item.
+  for (int i = 0; i < 100; i++)
+    REQUIRE_EQ_INT(wsdeque_append(deque, (item_t) { .type = 'i', .data.i = i }), 0);
+  CHECK_EQ_INT(wsdeque_length(deque), 100);
+
+  // The owner works from the end, thieves from the start.
+  CHECK_EQ_INT(wsdeque_remove(deque).data.i, 99);
+  CHECK_EQ_INT(wsdeque_steal(deque).data.i, 0);
+  CHECK_EQ_INT(wsdeque_remove(deque).data.i, 98);
+  CHECK_EQ_INT(wsdeque_steal(deque).data.i, 1);
+  for (int i = 97; i >= 2; i--)
+    CHECK_EQ_INT(wsdeque_remove(deque).data.i, i);
+  CHECK_TRUE(item_equal(wsdeque_remove(deque), ITEM_NULL));
+  CHECK_TRUE(item_equal(wsdeque_steal(deque), ITEM_NULL));
+  CHECK_EQ_INT(wsdeque_length(deque), 0);
+
+  wsdeque_free(deque);
+})
+
+static void take(item_t item) {
+  if (item.type != 'i') {
+    sched_yield();
+    return;
+  }
+  atomic_fetch_add(&seen[item.data.i], 1);
+  atomic_fetch_add(&taken, 1);
+}
+
+static void* thief(void* arg) {
+  (void) arg;
+  while (atomic_load(&taken) < ITEMS)
+    take(wsdeque_steal(shared));
+  return NULL;
+}
+
+TEST_CASE(threads, {
+  pthread_t thieves[THIEVES];
+
+  // Small, so it grows while being stolen from.
+  shared = wsdeque_new(4);
+  for (size_t i = 0; i < THIEVES; i++)
+    pthread_create(&thieves[i], NULL, thief, NULL);
+
+  // The owner takes back one of every few items it appends, racing the
+  // thieves for the last item whenever they have caught up.
+  for (int i = 0; i < ITEMS; i++) {
+    REQUIRE_EQ_INT(wsdeque_append(shared, (item_t) { .type = 'i', .data.i = i }), 0);
+    if (i % 3 == 0)
+      take(wsdeque_remove(shared));
+  }
+  while (atomic_load(&taken) < ITEMS)
+    take(wsdeque_remove(shared));
+  for (size_t i = 0; i < THIEVES; i++)
+    pthread_join(thieves[i], NULL);
+
+  // Every item came out exactly once.
+  int wrong = 0;
+  for (int i = 0; i < ITEMS; i++)
+    wrong += atomic_load(&seen[i]) != 1;
+  CHECK_EQ_INT(wrong, 0);
+
+  wsdeque_free(shared);
+})
+
+MAIN_RUN_TESTS(ends, threads)